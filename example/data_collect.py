@@ -43,7 +43,7 @@ def master_test(requests, number):
         for core in core_c:
             result_list = []
             for j in range(100):
-                comm = ("../src/new_main -g network-links.txt -c network-nodes.txt -N nfa_main.txt -t 12 -f test-trip-file.txt -s" + " " + str(core))
+                comm = ("../src/new_main -g network-links.txt -c network-nodes.txt -N nfa_main.txt -f test-trip-file.txt -s" + " " + str(core))
                 start = time.time()
                 subprocess_cmd(comm)
                 test = time.time() - start
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Compare throughput of one shared routing context (-A) against one replica
+# per NUMA node (-R), both with pinned workers.
+# Usage: ./numa_benchmark.sh [trip file] [workers] [runs]
+
+trips=${1:-test-trip-file.txt}
+workers=${2:-$(nproc)}
+runs=${3:-5}
+
+cd ../src
+make
+cd ../example
+
+echo NUMA nodes: $(ls -d /sys/devices/system/node/node[0-9]* 2>/dev/null | wc -l)
+ntrips=$(wc -l < $trips)
+
+for mode in -A -R; do
+    total=0
+    for i in $(seq $runs); do
+        start=$(date +%s.%N)
+        ../src/new_main -g network-links.txt -c network-nodes.txt -N nfa_main.txt -f $trips -o /tmp/numa_benchmark_plans.txt -s $workers $mode > /dev/null 2>&1
+        end=$(date +%s.%N)
+        total=$(awk "BEGIN {print $total + $end - $start}")
+    done
+    awk "BEGIN {printf \"$mode: average time %.3f s, %d trips/s\n\", $total / $runs, $ntrips * $runs / $total}"
+done
+rm -f /tmp/numa_benchmark_plans.txt
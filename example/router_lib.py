@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+# Binding of the routing library (../src/librouter.so, see router_api.h)
+# with ctypes: network and NFAs are loaded once, batches of trips are
+# routed in-process.  Trip and plan arrays are passed without copying;
+# any writable buffer of the right item type works (array.array here,
+# numpy arrays as well).
+#
+# Example:
+#   router = Router("network-links.txt", "network-nodes.txt", "nfa_main.txt")
+#   plans = router.route(sources, destinations, start_times, nfa_ids)
+#   for i in range(len(sources)):
+#       print(plans.path(i))
+import ctypes
+import os
+import sys
+from array import array
+
+RR_OK = 0
+RR_BUFFER_TOO_SMALL = -2
+RR_INVALID_ARGUMENT = -3
+
+RR_PLAN_FOUND = 1
+RR_BUDGET_EXCEEDED = 2
+RR_UNKNOWN_VERTEX = 4
+RR_UNKNOWN_NFA = 8
+
+
+class Options(ctypes.Structure):
+    _fields_ = [("algorithm", ctypes.c_int),
+                ("threads", ctypes.c_uint),
+                ("batch_trips", ctypes.c_size_t),
+                ("max_travel_time", ctypes.c_float),
+                ("max_settled", ctypes.c_ulong),
+                ("max_seconds", ctypes.c_double)]
+
+
+def _library(path=None):
+    if path is None:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "librouter.so")
+    lib = ctypes.CDLL(path)
+    p = ctypes.c_void_p
+    lib.rr_default_options.argtypes = [ctypes.POINTER(Options)]
+    lib.rr_load.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.POINTER(Options)]
+    lib.rr_load.restype = p
+    lib.rr_free.argtypes = [p]
+    lib.rr_last_error.restype = ctypes.c_char_p
+    lib.rr_nmb_nfas.argtypes = [p]
+    lib.rr_nmb_nfas.restype = ctypes.c_size_t
+    lib.rr_route.argtypes = [p, ctypes.c_size_t, p, p, p, p, ctypes.POINTER(ctypes.c_size_t)]
+    lib.rr_plans.argtypes = [p, p, p, p, p, p, ctypes.c_size_t]
+    return lib
+
+
+_ITEM_SIZES = {"q": 8, "Q": 8, "f": 4, "i": 4, "B": 1}
+
+
+def _address(buffer, typecode):
+    """Address of the data of a writable, contiguous buffer of typecode items."""
+    view = memoryview(buffer)
+    if view.itemsize != _ITEM_SIZES[typecode] or not view.c_contiguous:
+        raise TypeError("expected a contiguous buffer of type " + typecode)
+    if view.nbytes == 0:
+        return None
+    return ctypes.addressof(ctypes.c_char.from_buffer(view))
+
+
+class Plans:
+    """Plans of a batch: locations of trip i are offsets[i]..offsets[i+1]."""
+
+    def __init__(self, n, nmb_locations):
+        self.offsets = array("Q", bytes(8 * (n + 1)))
+        self.flags = array("B", bytes(n))
+        self.vertices = array("q", bytes(8 * nmb_locations))
+        self.times = array("f", bytes(4 * nmb_locations))
+        self.labels = array("i", bytes(4 * nmb_locations))
+
+    def path(self, i):
+        """(vertex, time, label) of the locations of trip i."""
+        return [(self.vertices[j], self.times[j], self.labels[j])
+                for j in range(self.offsets[i], self.offsets[i + 1])]
+
+
+class Router:
+    def __init__(self, links, nodes, nfas, algorithm=0, threads=0, library=None):
+        self.lib = _library(library)
+        options = Options()
+        self.lib.rr_default_options(ctypes.byref(options))
+        options.algorithm = algorithm
+        options.threads = threads
+        self.context = self.lib.rr_load(links.encode(), nodes.encode(), nfas.encode(), ctypes.byref(options))
+        if not self.context:
+            raise RuntimeError(self.lib.rr_last_error().decode())
+
+    def close(self):
+        if self.context:
+            self.lib.rr_free(self.context)
+            self.context = None
+
+    def __del__(self):
+        self.close()
+
+    def route(self, sources, destinations, start_times, nfa_ids):
+        """Route trips given as buffers of int64, int64, float32, int32."""
+        n = len(sources)
+        nmb_locations = ctypes.c_size_t()
+        status = self.lib.rr_route(self.context, n, _address(sources, "q"), _address(destinations, "q"),
+                                   _address(start_times, "f"), _address(nfa_ids, "i"),
+                                   ctypes.byref(nmb_locations))
+        if status != RR_OK:
+            raise RuntimeError(self.lib.rr_last_error().decode())
+        plans = Plans(n, nmb_locations.value)
+        status = self.lib.rr_plans(self.context, _address(plans.offsets, "Q"), _address(plans.vertices, "q"),
+                                   _address(plans.times, "f"), _address(plans.labels, "i"),
+                                   _address(plans.flags, "B"), nmb_locations.value)
+        if status != RR_OK:
+            raise RuntimeError(self.lib.rr_last_error().decode())
+        return plans
+
+
+if __name__ == "__main__":
+    # route a trip file (id source destination start_time nfa) and print
+    # the plans like new_main
+    if len(sys.argv) < 5:
+        print("Usage: router_lib.py <links> <nodes> <NFA collection> <trip file>")
+        sys.exit(0)
+    ids, sources, destinations, start_times, nfa_ids = [], array("q"), array("q"), array("f"), array("i")
+    with open(sys.argv[4]) as trips:
+        for line in trips:
+            fields = line.split()
+            if len(fields) == 5:
+                ids.append(int(fields[0]))
+                sources.append(int(fields[1]))
+                destinations.append(int(fields[2]))
+                start_times.append(float(fields[3]))
+                nfa_ids.append(int(float(fields[4])))
+    router = Router(sys.argv[1], sys.argv[2], sys.argv[3])
+    plans = router.route(sources, destinations, start_times, nfa_ids)
+    for i in range(len(ids)):
+        path = plans.path(i)
+        line = [ids[i], sources[i], destinations[i], len(path)]
+        for j, (vertex, time, label) in enumerate(path):
+            line += [vertex, "%g" % time] + ([label] if j > 0 else [])
+        print("\t".join(str(field) for field in line) + "\t")
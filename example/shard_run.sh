@@ -0,0 +1,21 @@
+#!/bin/bash
+# Route a trip file in N shard processes on this machine and merge the
+# shard outputs into one plans file sorted by trip ID.
+# Usage: ./shard_run.sh [trip file] [shards] [output] [hash|range]
+
+trips=${1:-test-trip-file.txt}
+shards=${2:-4}
+output=${3:-plans.txt}
+by=${4:-hash}
+
+cd ../src
+make
+cd ../example
+
+for i in $(seq 0 $((shards - 1))); do
+    ../src/new_main -g network-links.txt -c network-nodes.txt -N nfa_main.txt -f $trips -k -s 1 --shard $i/$shards --shard-by $by -o $output.shard$i > /dev/null &
+done
+wait
+
+../src/merge_plans $output $(for i in $(seq 0 $((shards - 1))); do echo $output.shard$i; done)
+rm -f $output.shard*
@@ -28,7 +28,7 @@ core_c =input("How many cores? ")
 subprocess_cmd("cd ../src; make; cd ../example;")
 result_list = []
 for i  in range(100):
-    comm = ("../src/new_main -g network-links.txt -c network-nodes.txt -N nfa_main.txt -t 12 -f test-trip-file.txt -s" + " " + str(core_c))
+    comm = ("../src/new_main -g network-links.txt -c network-nodes.txt -N nfa_main.txt -f test-trip-file.txt -s" + " " + str(core_c))
     start = time.time()
     subprocess_cmd(comm)
     test = time.time() - start
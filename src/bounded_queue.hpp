@@ -0,0 +1,155 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Lock-free bounded multi-producer multi-consumer queue.
+/// Ring buffer of cells with sequence numbers (D. Vyukov): a producer
+/// claims a cell by advancing the enqueue position with a compare-and-swap
+/// and publishes it by bumping the cell's sequence; consumers do the same
+/// on the dequeue side.  Neither side ever takes a lock.
+template <class T>
+class Bounded_Queue
+{
+protected:
+  /// Cell of the ring.
+  struct Cell
+  {
+    atomic<size_t> sequence;
+    T data;
+  };
+
+  /// Ring of cells.
+  vector<Cell> buffer;
+
+  /// Capacity minus one (capacity is a power of two).
+  size_t mask;
+
+  /// Next position to enqueue (own cache line).
+  alignas(64) atomic<size_t> enqueue_pos;
+
+  /// Next position to dequeue (own cache line).
+  alignas(64) atomic<size_t> dequeue_pos;
+
+
+public:
+  /// Constructor; capacity is rounded up to a power of two.
+  Bounded_Queue(size_t capacity);
+
+  /// Enqueue element; false if the queue is full.
+  bool try_push(const T& data);
+
+  /// Dequeue element; false if the queue is empty.
+  bool try_pop(T& data);
+};
+
+
+template <class T>
+Bounded_Queue<T>::Bounded_Queue(size_t capacity):
+  buffer(), mask(0), enqueue_pos(0), dequeue_pos(0)
+{
+  size_t size = 2;
+  while (size < capacity)
+    size *= 2;
+  buffer = vector<Cell>(size);
+  mask = size - 1;
+  for (size_t i = 0; i < size; ++i)
+    buffer[i].sequence.store(i, memory_order_relaxed);
+}
+
+
+template <class T>
+bool Bounded_Queue<T>::try_push(const T& data)
+{
+  size_t pos = enqueue_pos.load(memory_order_relaxed);
+  for (;;)
+  {
+    Cell& cell = buffer[pos & mask];
+    size_t seq = cell.sequence.load(memory_order_acquire);
+    long diff = (long)seq - (long)pos;
+    if (diff == 0)
+    {
+      if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+      {
+	cell.data = data;
+	cell.sequence.store(pos + 1, memory_order_release);
+	return true;
+      }
+    }
+    else if (diff < 0)
+      return false;
+    else
+      pos = enqueue_pos.load(memory_order_relaxed);
+  }
+}
+
+
+template <class T>
+bool Bounded_Queue<T>::try_pop(T& data)
+{
+  size_t pos = dequeue_pos.load(memory_order_relaxed);
+  for (;;)
+  {
+    Cell& cell = buffer[pos & mask];
+    size_t seq = cell.sequence.load(memory_order_acquire);
+    long diff = (long)seq - (long)(pos + 1);
+    if (diff == 0)
+    {
+      if (dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+      {
+	data = cell.data;
+	cell.sequence.store(pos + mask + 1, memory_order_release);
+	return true;
+      }
+    }
+    else if (diff < 0)
+      return false;
+    else
+      pos = dequeue_pos.load(memory_order_relaxed);
+  }
+}
+
+
+
+/// Back-off for polling loops: yield first, then sleep briefly.
+class Back_Off
+{
+protected:
+  /// Number of unsuccessful polls.
+  unsigned int nmb_polls;
+
+public:
+  /// Constructor.
+  Back_Off(): nmb_polls(0) {}
+
+  /// Wait before polling again.
+  void wait()
+  {
+    if (++nmb_polls < 64)
+      this_thread::yield();
+    else
+      this_thread::sleep_for(chrono::microseconds(50));
+  }
+
+  /// Reset after a successful poll.
+  void reset() { nmb_polls = 0; }
+};
+
+
+#endif
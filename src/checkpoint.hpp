@@ -0,0 +1,252 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "basics.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Get stamp (name, size and modification time) of a file, to notice
+/// changed input files.
+string file_stamp(const string& filename)
+{
+  struct stat status;
+  if (stat(filename.c_str(), &status) != 0)
+    return filename + " missing";
+  return filename + " " + itos(status.st_size) + " " + itos(status.st_mtime);
+}
+
+
+/// Wait until the data of a file is on disk; false on error.
+bool sync_file(const char* filename)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool ok = fdatasync(fd) == 0;
+  return close(fd) == 0 && ok;
+}
+
+
+
+/// Progress of a batch run over its batches (work ranges), saved from
+/// time to time so that a killed run can be resumed.  A checkpoint file
+/// records the run (a hash of its inputs and options), the output offset
+/// up to which plans are on disk, and the ranges of batches whose plans
+/// lie before that offset:
+///
+///   # Reg-Exp Router checkpoint
+///   run <hex key>
+///   batches <number of batches>
+///   output <offset>
+///   done <first batch> <batch past the last one>
+///   ...
+///
+/// A resumed run cuts the output back to the offset, skips the completed
+/// batches and appends the plans of the others.  The checkpoint is only
+/// used by the writer thread once routing has started.
+class Checkpoint
+{
+protected:
+  /// Checkpoint file.
+  string filename;
+
+  /// Output file.
+  string output_filename;
+
+  /// Key of the run.
+  uint64_t run_key;
+
+  /// Has a checkpoint of this run been loaded?
+  bool resuming;
+
+  /// Number of batches of the loaded checkpoint.
+  size_t loaded_batches;
+
+  /// Output offset up to which plans are on disk.
+  uint64_t durable_offset;
+
+  /// Output offset after the plans written so far.
+  uint64_t written_offset;
+
+  /// Batches whose plans are on disk.
+  vector<bool> completed;
+
+  /// Batches written since the last save.
+  vector<size_t> unsaved;
+
+  /// Message of the last error.
+  string error_message;
+
+
+public:
+  /// Constructor; run describes inputs and options of the run.
+  Checkpoint(const char* checkpoint_filename, const char* output, const string& run);
+
+  /// Read the checkpoint file, if there is one; false with error message
+  /// if it is damaged or belongs to another run.
+  bool load();
+
+  /// Is a run resumed?
+  bool resumed() const { return resuming; }
+
+  /// Get output offset up to which plans are on disk.
+  uint64_t output_offset() const { return durable_offset; }
+
+  /// Start routing nmb_batches batches (the output is open and flushed).
+  /// In order, only a prefix of batches counts as completed.  False with
+  /// error message if the batches differ from the loaded checkpoint.
+  bool start(size_t nmb_batches, bool in_order);
+
+  /// Get completed batches.
+  const vector<bool>& done() const { return completed; }
+
+  /// Get number of completed batches.
+  size_t nmb_done() const { return count(completed.begin(), completed.end(), true); }
+
+  /// Record batches whose plans (bytes bytes) have been written.
+  void written(const vector<size_t>& batches, size_t bytes)
+  {
+    unsaved.insert(unsaved.end(), batches.begin(), batches.end());
+    written_offset += bytes;
+  }
+
+  /// Wait until the written plans are on disk, then save the checkpoint
+  /// file (replaced atomically).  The output must have been flushed.
+  bool save();
+
+  /// Remove the checkpoint file after a completed run.
+  void remove() { ::remove(filename.c_str()); }
+
+  /// Get message of the last error.
+  const string& error() const { return error_message; }
+};
+
+
+Checkpoint::Checkpoint(const char* checkpoint_filename, const char* output, const string& run):
+  filename(checkpoint_filename), output_filename(output), run_key(0xcbf29ce484222325ULL),
+  resuming(false), loaded_batches(0), durable_offset(0), written_offset(0),
+  completed(), unsaved(), error_message()
+{
+  for (size_t i = 0; i < run.size(); ++i)
+    run_key = (run_key ^ (unsigned char)run[i]) * 0x100000001b3ULL;
+}
+
+
+bool Checkpoint::load()
+{
+  ifstream file(filename.c_str());
+  if (!file)
+    return true;
+
+  string line, word;
+  getline(file, line);
+  uint64_t key = 0;
+  bool ok = (file >> word >> hex >> key >> dec) && word == "run" &&
+    (file >> word >> loaded_batches) && word == "batches" &&
+    (file >> word >> durable_offset) && word == "output";
+  if (ok && key != run_key)
+  {
+    error_message = "the checkpoint " + filename + " belongs to another run (inputs or options differ).";
+    return false;
+  }
+  completed.assign(loaded_batches, false);
+  size_t first, end;
+  while (ok && file >> word)
+  {
+    ok = word == "done" && (file >> first >> end) && first <= end && end <= loaded_batches;
+    for (size_t b = first; ok && b < end; ++b)
+      completed[b] = true;
+  }
+  if (!ok)
+  {
+    error_message = "the checkpoint " + filename + " is damaged.";
+    return false;
+  }
+  struct stat status;
+  if (stat(output_filename.c_str(), &status) != 0 || (uint64_t)status.st_size < durable_offset)
+  {
+    error_message = "the output " + output_filename + " is shorter than recorded in the checkpoint " + filename + ".";
+    return false;
+  }
+  resuming = true;
+  return true;
+}
+
+
+bool Checkpoint::start(size_t nmb_batches, bool in_order)
+{
+  if (resuming && nmb_batches != loaded_batches)
+  {
+    error_message = "the checkpoint " + filename + " has " + itos(loaded_batches)
+      + " batches, but the run has " + itos(nmb_batches) + ".";
+    return false;
+  }
+  if (!resuming)
+  {
+    struct stat status;
+    completed.assign(nmb_batches, false);
+    durable_offset = stat(output_filename.c_str(), &status) == 0 ? status.st_size : 0;
+  }
+  if (in_order)
+    fill(find(completed.begin(), completed.end(), false), completed.end(), false);
+  written_offset = durable_offset;
+  return true;
+}
+
+
+bool Checkpoint::save()
+{
+  if (!sync_file(output_filename.c_str()))
+    return false;
+  for (size_t i = 0; i < unsaved.size(); ++i)
+    completed[unsaved[i]] = true;
+  unsaved.clear();
+  durable_offset = written_offset;
+
+  string temporary = filename + ".tmp";
+  FILE* file = fopen(temporary.c_str(), "w");
+  if (file == NULL)
+    return false;
+  fprintf(file, "# Reg-Exp Router checkpoint\nrun %llx\nbatches %zu\noutput %llu\n",
+	  (unsigned long long)run_key, completed.size(), (unsigned long long)durable_offset);
+  for (size_t b = 0; b < completed.size(); )
+  {
+    if (!completed[b])
+    {
+      ++b;
+      continue;
+    }
+    size_t first = b;
+    while (b < completed.size() && completed[b])
+      ++b;
+    fprintf(file, "done %zu %zu\n", first, b);
+  }
+  bool ok = fflush(file) == 0 && fdatasync(fileno(file)) == 0;
+  ok = fclose(file) == 0 && ok;
+  return ok && rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+
+#endif
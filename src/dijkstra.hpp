@@ -17,8 +17,10 @@
 #include <ext/hash_map>
 
 #include "basics.hpp"
+#include "edge_costs.hpp"
 #include "events.hpp"
 #include "graph.hpp"
+#include "timer.hpp"
 
 #include <log4cplus/logger.h>
 #include <log4cplus/loglevel.h>
@@ -279,6 +281,24 @@ struct Trip_Request
 };
 
 
+/// Limits of one search (0: no limit).
+/// A search that hits a limit is aborted and yields no plan.
+struct Search_Budget
+{
+  /// Maximum travel time from the start time.
+  float max_travel_time;
+
+  /// Maximum number of settled product vertices.
+  unsigned long max_settled;
+
+  /// Maximum wall-clock time in seconds.
+  double max_seconds;
+
+  /// Constructor; no limits.
+  Search_Budget(): max_travel_time(0), max_settled(0), max_seconds(0) {}
+};
+
+
 /// Output operator.
 ostream& operator<<(ostream& out, Trip_Request& request)
 {
@@ -325,6 +345,12 @@ struct Plan
   /// Path description.
   list<Location> path;
 
+  /// Was the search aborted by its budget (path is empty then)?
+  bool budget_exceeded;
+
+  /// Constructor.
+  Plan(): path(), budget_exceeded(false) {}
+
   /// Reverse path.
   void reverse() { path.reverse(); }
 };
@@ -367,15 +393,50 @@ protected:
   /// Current product vertex.
   Touched_Vertex* curr_touched;
 
+  /// Edge costs of the current query (NULL: costs of the network).
+  const Edge_Costs* edge_costs;
+
+  /// Limits of each search.
+  Search_Budget budget;
+
+  /// Number of product vertices settled by the current search.
+  unsigned long nmb_settled;
+
+  /// Wall-clock time of the current search.
+  Timer search_timer;
+
+  /// Was the current search aborted by its budget?
+  bool aborted;
+
   /// Logger.
   Logger dijkstra_logger;
 
+  /// Get edge cost without heuristic.
+  Cost_Function edge_cost(Network_Edge* edge) const
+  {
+    return edge_costs ? edge_costs->cost[edge->id()] : edge->cost();
+  }
+
+  /// Get lower bound on the travel time of paths through the current vertex.
+  virtual float travel_time() const { return curr_touched->dist() - start_time; }
+
+  /// Has the current search exceeded its budget?
+  /// The clock is only read every 64 settled vertices.
+  bool over_budget()
+  {
+    return (budget.max_travel_time > 0 && travel_time() > budget.max_travel_time) ||
+      (budget.max_settled > 0 && nmb_settled > budget.max_settled) ||
+      (budget.max_seconds > 0 && nmb_settled % 64 == 0 &&
+       search_timer.elapsed() > budget.max_seconds);
+  }
+
 
 public:
   /// Constructor.
   Shortest_Path(Network_Graph& n1, NFA_Graph& n2):
     network(n1), nfa(n2), source(NULL), destination(NULL), start_time(0),
-    queue(), vertex_info(), curr_touched(NULL),
+    queue(), vertex_info(), curr_touched(NULL), edge_costs(NULL),
+    budget(), nmb_settled(0), search_timer(), aborted(false),
     dijkstra_logger(Logger::getInstance("Shortest_Path"))
   {
     dijkstra_logger.addAppender(myConsoleAppender);
@@ -389,10 +450,20 @@ public:
   /// Initialization.
   virtual void init(const Trip_Request& trip);
 
+  /// Search on given edge costs (NULL: costs of the network) until the
+  /// next call; the caller keeps them alive meanwhile.
+  void set_costs(const Edge_Costs* costs) { edge_costs = costs; }
+
+  /// Limit the following searches.
+  void set_budget(const Search_Budget& b) { budget = b; }
+
+  /// Was the last search aborted by its budget?
+  bool budget_exceeded() const { return aborted; }
+
   /// Get edge cost.
   virtual Cost_Function cost(Network_Edge* edge) const
   {
-    return edge->cost();
+    return edge_cost(edge);
   }
 
   /// Insert vertex in queue.
@@ -510,11 +581,23 @@ void Shortest_Path::relax(Product_Neighbor_Iterator& neighbor_it)
 void Shortest_Path::dijkstra()
 {
   LOG4CPLUS_DEBUG(dijkstra_logger, "Running search...");
+  nmb_settled = 0;
+  aborted = false;
+  if (budget.max_seconds > 0)
+    search_timer.restart();
   do
   {
     LOG4CPLUS_DEBUG(dijkstra_logger, "Popping item...");
+    ++nmb_settled;
     pop();
     LOG4CPLUS_DEBUG(dijkstra_logger, "Popped item: " + curr_touched->info());
+    if (over_budget())
+    {
+      // keys are popped in increasing order: no later vertex is in budget
+      LOG4CPLUS_DEBUG(dijkstra_logger, "Search budget exceeded.");
+      aborted = true;
+      break;
+    }
     LOG4CPLUS_DEBUG(dijkstra_logger, "For all incident edges...");
     for (Product_Neighbor_Iterator neighbor_it(curr_touched->vertex());
 	 neighbor_it.valid(); ++neighbor_it)
@@ -558,6 +641,41 @@ void Shortest_Path::reconstruct_path(Plan& plan)
 // ----------------------------------------------------------------------------
 
 
+/// Maximum speed (Euclidean length per cost) over all network edges.
+float max_network_speed(Network_Graph& network)
+{
+  float max_speed = 0;
+  for (Network_Graph::const_iterator vertex_it=network.begin();
+       vertex_it!=network.end(); vertex_it++)
+    for (Network_Vertex::Edge_It edge_it=(*vertex_it)->out_edge_begin();
+	 edge_it!=(*vertex_it)->out_edge_end(); edge_it++)
+    {
+      double curr_speed =
+	euclid_dist((*edge_it)->head(), (*edge_it)->tail()) / (*edge_it)->cost();
+      if (curr_speed > max_speed)
+	max_speed = curr_speed;
+    }
+  return max_speed;
+}
+
+
+/// Maximum Euclidean length over all network edges.
+float max_edge_length(Network_Graph& network)
+{
+  float max_length = 0;
+  for (Network_Graph::const_iterator vertex_it=network.begin();
+       vertex_it!=network.end(); vertex_it++)
+    for (Network_Vertex::Edge_It edge_it=(*vertex_it)->out_edge_begin();
+	 edge_it!=(*vertex_it)->out_edge_end(); edge_it++)
+    {
+      double curr_length = euclid_dist((*edge_it)->head(), (*edge_it)->tail());
+      if (curr_length > max_length)
+	max_length = curr_length;
+    }
+  return max_length;
+}
+
+
 /// Goal-directed Dijkstra.
 class Goal_Dijkstra: public Shortest_Path
 {
@@ -565,32 +683,26 @@ protected:
   /// Maximum speed.
   float max_speed;
 
+  /// Get maximum speed under the current edge costs.
+  float speed() const { return edge_costs ? edge_costs->max_speed : max_speed; }
+
 
 public:
   /// Constructor.
   Goal_Dijkstra(Network_Graph& network, NFA_Graph& nfa):
-    Shortest_Path(network, nfa)
-  {
-    max_speed = 0;
-    for (Network_Graph::const_iterator vertex_it=network.begin();
-	 vertex_it!=network.end(); vertex_it++)
-      for (Network_Vertex::Edge_It edge_it=(*vertex_it)->out_edge_begin();
-	   edge_it!=(*vertex_it)->out_edge_end(); edge_it++)
-      {
-	double curr_speed =
-	  euclid_dist((*edge_it)->head(), (*edge_it)->tail()) / (*edge_it)->cost();
-	if (curr_speed > max_speed)
-	  max_speed = curr_speed;
-      }
-  }
+    Shortest_Path(network, nfa), max_speed(max_network_speed(network)) {}
+
+  /// Constructor with precomputed maximum speed.
+  Goal_Dijkstra(Network_Graph& network, NFA_Graph& nfa, float speed):
+    Shortest_Path(network, nfa), max_speed(speed) {}
 
   /// Get edge cost.
   /// \todo Retranslate edge costs in reconstruct_path.
   virtual Cost_Function cost(Network_Edge* edge) const
   {
-    Cost_Function new_cost = edge->cost()
-      + euclid_dist(edge->head(), destination) / max_speed
-      - euclid_dist(edge->tail(), destination) / max_speed;
+    Cost_Function new_cost = edge_cost(edge)
+      + euclid_dist(edge->head(), destination) / speed()
+      - euclid_dist(edge->tail(), destination) / speed();
     assert(new_cost >= -0.001);
     return new_cost;
   }
@@ -611,8 +723,8 @@ void Goal_Dijkstra::reconstruct_path(Plan& plan)
       plan.path.push_front(Location(curr_touched->vertex().network()->external_id(),
 				    curr_touched->dist()
 				    - euclid_dist(curr_touched->vertex().network(),
-						  destination) / max_speed
-				    + euclid_dist(source, destination) / max_speed,
+						  destination) / speed()
+				    + euclid_dist(source, destination) / speed(),
                 curr_touched->label()));
       curr_touched = vertex_info[curr_touched->parent()];
     }
@@ -632,23 +744,32 @@ void Goal_Dijkstra::reconstruct_path(Plan& plan)
 class Bi_Dijkstra: public Shortest_Path
 {
 protected:
+  /// Backward network.
+  Back_Network& back_network;
+
+  /// Backward NFA.
+  Back_NFA& back_nfa;
+
+  /// Are the backward graphs owned by this engine?
+  bool own_back;
+
   /// Network for backward search.
-  Network_Graph network_back;
+  Network_Graph& network_back;
 
   /// Mapping from original to backward network.
-  map<Network_Vertex*, Network_Vertex*> network_back_vertex;
+  const map<Network_Vertex*, Network_Vertex*>& network_back_vertex;
 
   /// Mapping from backward to original network.
-  map<Network_Vertex*, Network_Vertex*> network_orig_vertex;
+  const map<Network_Vertex*, Network_Vertex*>& network_orig_vertex;
 
   /// Mapping from original to backward NFA.
-  map<NFA_Vertex*, NFA_Vertex*> nfa_back_vertex;
+  const map<NFA_Vertex*, NFA_Vertex*>& nfa_back_vertex;
 
   /// Mapping from backward to original NFA.
-  map<NFA_Vertex*, NFA_Vertex*> nfa_orig_vertex;
+  const map<NFA_Vertex*, NFA_Vertex*>& nfa_orig_vertex;
 
   /// NFA for backward search.
-  NFA_Graph nfa_back;
+  NFA_Graph& nfa_back;
 
   /// Queue for backward search.
   Priority_Queue queue_back;
@@ -673,23 +794,45 @@ protected:
   Logger bi_logger;
 
 
-public:
-  /// Constructor.
-  Bi_Dijkstra(Network_Graph& network, NFA_Graph& nfa):
-    Shortest_Path(network, nfa), network_back_vertex(), network_orig_vertex(),
-    nfa_back_vertex(), nfa_orig_vertex(), queue_back(),
+  /// Constructor with given backward graphs.
+  Bi_Dijkstra(Network_Graph& network, NFA_Graph& nfa,
+	      Back_Network& back_net, Back_NFA& back_aut, bool own):
+    Shortest_Path(network, nfa), back_network(back_net), back_nfa(back_aut),
+    own_back(own), network_back(back_net.graph),
+    network_back_vertex(back_net.back_vertex),
+    network_orig_vertex(back_net.orig_vertex),
+    nfa_back_vertex(back_aut.back_vertex), nfa_orig_vertex(back_aut.orig_vertex),
+    nfa_back(back_aut.graph), queue_back(),
     queue_number(1), visited(), shortest_distance(INF),
     link_vertex_for(NULL_PRODUCT_VERTEX), link_vertex_back(NULL_PRODUCT_VERTEX),
     bi_logger(Logger::getInstance("Bi_Dijkstra"))
   {
-    network.construct_back_graph(network_back, network_back_vertex,
-				 network_orig_vertex);
-    nfa.construct_back_graph(nfa_back, nfa_back_vertex,
-			     nfa_orig_vertex);
     bi_logger.addAppender(myConsoleAppender);
     bi_logger.setLogLevel(INFO_LOG_LEVEL);
   }
 
+
+public:
+  /// Constructor.
+  Bi_Dijkstra(Network_Graph& network, NFA_Graph& nfa):
+    Bi_Dijkstra(network, nfa, *new Back_Network(network), *new Back_NFA(nfa),
+		true) {}
+
+  /// Constructor with backward graphs shared with other engines.
+  Bi_Dijkstra(Network_Graph& network, NFA_Graph& nfa,
+	      Back_Network& back_net, Back_NFA& back_aut):
+    Bi_Dijkstra(network, nfa, back_net, back_aut, false) {}
+
+  /// Destructor.
+  virtual ~Bi_Dijkstra()
+  {
+    if (own_back)
+    {
+      delete &back_network;
+      delete &back_nfa;
+    }
+  }
+
   /// Initialization.
   virtual void init(const Trip_Request& trip);
 
@@ -753,7 +896,7 @@ public:
   {
     if (queue_number == 1)
     {
-      Product_Vertex head_product_back(network_back_vertex[neighbor_it.head().network()], nfa_back_vertex[neighbor_it.head().nfa()]);
+      Product_Vertex head_product_back(network_back_vertex.at(neighbor_it.head().network()), nfa_back_vertex.at(neighbor_it.head().nfa()));
       if (vertex_info[head_product_back] != NULL &&
 	  vertex_info[neighbor_it.tail()]->dist() +
 	  cost(neighbor_it.network_edge()) +
@@ -770,7 +913,7 @@ public:
     }
     else
     {
-      Product_Vertex head_product_orig(network_orig_vertex[neighbor_it.head().network()], nfa_orig_vertex[neighbor_it.head().nfa()]);
+      Product_Vertex head_product_orig(network_orig_vertex.at(neighbor_it.head().network()), nfa_orig_vertex.at(neighbor_it.head().nfa()));
       if (vertex_info[head_product_orig] != NULL &&
 	  vertex_info[neighbor_it.tail()]->dist() +
 	  cost(neighbor_it.network_edge()) +
@@ -779,7 +922,7 @@ public:
 	shortest_distance = vertex_info[neighbor_it.tail()]->dist() +
 	  cost(neighbor_it.network_edge()) +
 	  vertex_info[head_product_orig]->dist();
-	link_vertex_for = Product_Vertex(network_orig_vertex[neighbor_it.head().network()], nfa_orig_vertex[neighbor_it.head().nfa()]);
+	link_vertex_for = Product_Vertex(network_orig_vertex.at(neighbor_it.head().network()), nfa_orig_vertex.at(neighbor_it.head().nfa()));
 	link_vertex_back = neighbor_it.head();
 	LOG4CPLUS_TRACE(bi_logger, "Link vertices: " + link_vertex_for.info() + "  "
 			+ link_vertex_back.info());
@@ -803,8 +946,8 @@ public:
     bool return_value = false;
     if (queue_number == 1)
     {
-      Product_Vertex product_vertex(network_back_vertex[curr_touched->vertex().network()],
-				    nfa_back_vertex[curr_touched->vertex().nfa()]);
+      Product_Vertex product_vertex(network_back_vertex.at(curr_touched->vertex().network()),
+				    nfa_back_vertex.at(curr_touched->vertex().nfa()));
       LOG4CPLUS_TRACE(bi_logger, "Current backward vertex: " + product_vertex.info()
 		      + "  visited: " + itos(visited[product_vertex]));
       if (visited[product_vertex])
@@ -812,8 +955,8 @@ public:
     }
     else if (queue_number == -1)
     {
-      Product_Vertex product_vertex(network_orig_vertex[curr_touched->vertex().network()],
-				    nfa_orig_vertex[curr_touched->vertex().nfa()]);
+      Product_Vertex product_vertex(network_orig_vertex.at(curr_touched->vertex().network()),
+				    nfa_orig_vertex.at(curr_touched->vertex().nfa()));
       LOG4CPLUS_TRACE(bi_logger, "Current original vertex: " + product_vertex.info()
 		      + "  visited: " + itos(visited[product_vertex]));
       if (visited[product_vertex])
@@ -826,6 +969,13 @@ public:
   /// Are queues empty?
   virtual bool queue_empty() { return queue.empty() && queue_back.empty(); }
 
+  /// Get lower bound on the travel time of paths through the current vertex
+  /// (backward distances start at 0).
+  virtual float travel_time() const
+  {
+    return queue_number == 1 ? curr_touched->dist() - start_time : curr_touched->dist();
+  }
+
   /// Reconstruct path.
   virtual void reconstruct_path(Plan& plan);
 };
@@ -846,7 +996,7 @@ void Bi_Dijkstra::init(const Trip_Request& trip)
   list<NFA_Vertex*> start_states = nfa_back.start();
   while (!start_states.empty())
   {
-    Product_Vertex source_product(network_back_vertex[destination],
+    Product_Vertex source_product(network_back_vertex.at(destination),
 				  start_states.front());
     start_states.pop_front();
   // currently made edge_label=-1
@@ -940,30 +1090,26 @@ protected:
   /// Maximum speed.
   float max_speed;
 
+  /// Get maximum speed under the current edge costs.
+  float speed() const { return edge_costs ? edge_costs->max_speed : max_speed; }
+
 
 public:
   /// Constructor.
   Bi_Goal_Dijkstra(Network_Graph& network, NFA_Graph& nfa):
-    Bi_Dijkstra(network, nfa)
-  {
-    max_speed = 0;
-    for (Network_Graph::const_iterator vertex_it=network.begin();
-	 vertex_it!=network.end(); vertex_it++)
-      for (Network_Vertex::Edge_It edge_it=(*vertex_it)->out_edge_begin();
-	   edge_it!=(*vertex_it)->out_edge_end(); edge_it++)
-      {
-	double curr_speed = euclid_dist((*edge_it)->head(), (*edge_it)->tail());
-	if (curr_speed > max_speed)
-	  max_speed = curr_speed;
-      }
-  }
+    Bi_Dijkstra(network, nfa), max_speed(max_edge_length(network)) {}
+
+  /// Constructor with shared backward graphs and precomputed maximum speed.
+  Bi_Goal_Dijkstra(Network_Graph& network, NFA_Graph& nfa,
+		   Back_Network& back_net, Back_NFA& back_aut, float speed):
+    Bi_Dijkstra(network, nfa, back_net, back_aut), max_speed(speed) {}
 
   /// Get edge cost.
   virtual Cost_Function cost(Network_Edge* edge) const
   {
-    Cost_Function new_cost = edge->cost()
-      + euclid_dist(edge->head(), destination) / max_speed
-      - euclid_dist(edge->tail(), destination) / max_speed;
+    Cost_Function new_cost = edge_cost(edge)
+      + euclid_dist(edge->head(), destination) / speed()
+      - euclid_dist(edge->tail(), destination) / speed();
     assert(new_cost >= -0.001);
     return new_cost;
   }
@@ -971,9 +1117,9 @@ public:
   /// Get backward edge cost.
   virtual Cost_Function cost_back(Network_Edge* edge) const
   {
-    Cost_Function new_cost = edge->cost()
-      - euclid_dist(edge->head(), destination) / max_speed
-      + euclid_dist(edge->tail(), destination) / max_speed;
+    Cost_Function new_cost = edge_cost(edge)
+      - euclid_dist(edge->head(), destination) / speed()
+      + euclid_dist(edge->tail(), destination) / speed();
     assert(new_cost >= -0.001);
     return new_cost;
   }
@@ -983,7 +1129,7 @@ public:
   {
     if (queue_number == 1)
     {
-      Product_Vertex head_product_back(network_back_vertex[neighbor_it.head().network()], nfa_back_vertex[neighbor_it.head().nfa()]);
+      Product_Vertex head_product_back(network_back_vertex.at(neighbor_it.head().network()), nfa_back_vertex.at(neighbor_it.head().nfa()));
       if (vertex_info[head_product_back] != NULL &&
 	  vertex_info[neighbor_it.tail()]->dist() +
 	  cost(neighbor_it.network_edge()) +
@@ -998,7 +1144,7 @@ public:
     }
     else
     {
-      Product_Vertex head_product_orig(network_orig_vertex[neighbor_it.head().network()], nfa_orig_vertex[neighbor_it.head().nfa()]);
+      Product_Vertex head_product_orig(network_orig_vertex.at(neighbor_it.head().network()), nfa_orig_vertex.at(neighbor_it.head().nfa()));
       if (vertex_info[head_product_orig] != NULL &&
 	  vertex_info[neighbor_it.tail()]->dist() +
 	  cost_back(neighbor_it.network_edge()) +
@@ -1007,7 +1153,7 @@ public:
 	shortest_distance =  vertex_info[neighbor_it.tail()]->dist() +
 	  cost_back(neighbor_it.network_edge()) +
 	  vertex_info[head_product_orig]->dist();
-	link_vertex_for = Product_Vertex(network_orig_vertex[neighbor_it.head().network()], nfa_orig_vertex[neighbor_it.head().nfa()]);
+	link_vertex_for = Product_Vertex(network_orig_vertex.at(neighbor_it.head().network()), nfa_orig_vertex.at(neighbor_it.head().nfa()));
 	link_vertex_back = neighbor_it.head();
       }
     }
@@ -1073,8 +1219,8 @@ void Bi_Goal_Dijkstra::reconstruct_path(Plan& plan)
     if (curr_touched->parent() != NULL_PRODUCT_VERTEX)
     {
       link_dist_for = curr_touched->dist()
-	- euclid_dist(curr_touched->vertex().network(), destination) / max_speed
-	+ euclid_dist(source, destination)  / max_speed;
+	- euclid_dist(curr_touched->vertex().network(), destination) / speed()
+	+ euclid_dist(source, destination)  / speed();
       LOG4CPLUS_TRACE(bi_logger, "Link vertex distance forward: " + ftos(link_dist_for));
       do
       {
@@ -1082,9 +1228,9 @@ void Bi_Goal_Dijkstra::reconstruct_path(Plan& plan)
 	plan.path.push_front(Location(curr_touched->vertex().network()->external_id(),
 				      curr_touched->dist()
 				      - euclid_dist(curr_touched->vertex().network(),
-						    destination) / max_speed
+						    destination) / speed()
 				      + euclid_dist(source, destination) /
-                  max_speed,curr_touched->label()));
+                  speed(),curr_touched->label()));
 	curr_touched = vertex_info[curr_touched->parent()];
 	LOG4CPLUS_TRACE(bi_logger, "Current vertex: " + curr_touched->info());
       } while (curr_touched->parent() != NULL_PRODUCT_VERTEX);
@@ -1099,7 +1245,7 @@ void Bi_Goal_Dijkstra::reconstruct_path(Plan& plan)
     if (curr_touched->parent() != NULL_PRODUCT_VERTEX)
     {
       link_dist_back = curr_touched->dist()
-	+ euclid_dist(curr_touched->vertex().network(), destination) / max_speed;
+	+ euclid_dist(curr_touched->vertex().network(), destination) / speed();
       LOG4CPLUS_TRACE(bi_logger, "Link vertex distance backward: " + ftos(link_dist_back));
       while (curr_touched->parent() != NULL_PRODUCT_VERTEX)
       {
@@ -1111,7 +1257,7 @@ void Bi_Goal_Dijkstra::reconstruct_path(Plan& plan)
 	plan.path.push_back(Location(curr_touched->vertex().network()->external_id(),
 				     link_dist_for + link_dist_back - curr_touched->dist()
 				     - euclid_dist(curr_touched->vertex().network(),
-                   destination) / max_speed,prev_edge_label));
+                   destination) / speed(),prev_edge_label));
       }
     }
   }
@@ -1119,4 +1265,141 @@ void Bi_Goal_Dijkstra::reconstruct_path(Plan& plan)
 }
 
 
+
+// ----------------------------------------------------------------------------
+
+
+/// Joint Dijkstra for several NFAs.
+/// Searches the product of the network with the disjoint union of the NFAs
+/// once, answering a bundle of (destination, NFA) queries that share source
+/// and start time.  Product vertices are tagged by NFA through the union
+/// state they contain.
+class Multi_NFA_Dijkstra: public Shortest_Path
+{
+protected:
+  /// NFA index of each union state (indexed by state ID).
+  const vector<unsigned int>& nfa_tag;
+
+  /// Start state of each NFA within the union.
+  const vector<NFA_Vertex*>& nfa_start;
+
+  /// Bundle targets at each destination vertex.
+  map<Network_Vertex*, vector<unsigned int> > targets_at;
+
+  /// NFA index of each target.
+  vector<unsigned int> target_nfa;
+
+  /// Touched vertex reaching each target (NULL if not reached).
+  vector<Touched_Vertex*> target_reached;
+
+  /// Number of targets not reached yet.
+  unsigned int nmb_open;
+
+
+public:
+  /// Constructor.
+  Multi_NFA_Dijkstra(Network_Graph& network, NFA_Graph& nfa_union,
+		     const vector<unsigned int>& tag,
+		     const vector<NFA_Vertex*>& start):
+    Shortest_Path(network, nfa_union), nfa_tag(tag), nfa_start(start),
+    targets_at(), target_nfa(), target_reached(), nmb_open(0) {}
+
+  /// Initialization for a bundle of trips with common source and start time.
+  /// Trip i of the bundle becomes target i.
+  void init(const vector<Trip_Request>& bundle);
+
+  /// Get next vertex from queue and register reached targets.
+  virtual void pop();
+
+  /// Have all targets been reached?
+  virtual bool finished() { return nmb_open == 0; }
+
+  /// Reconstruct path to given target.
+  void reconstruct_path(Plan& plan, unsigned int target);
+};
+
+
+void Multi_NFA_Dijkstra::init(const vector<Trip_Request>& bundle)
+{
+  LOG4CPLUS_DEBUG(dijkstra_logger, "Initializing bundle...");
+  source = network[network.internal_id(bundle.front().source)];
+  destination = NULL;
+  start_time = bundle.front().start_time;
+
+  vertex_info.clear();
+  queue = Priority_Queue();
+  targets_at.clear();
+  target_nfa.resize(bundle.size());
+  target_reached.assign(bundle.size(), (Touched_Vertex*)NULL);
+  nmb_open = bundle.size();
+
+  vector<bool> nfa_used(nfa_start.size(), false);
+  for (unsigned int i=0; i<bundle.size(); ++i)
+  {
+    target_nfa[i] = (unsigned int)bundle[i].nfaID;
+    assert(target_nfa[i] < nfa_start.size());
+    targets_at[network[network.internal_id(bundle[i].destination)]].push_back(i);
+    nfa_used[target_nfa[i]] = true;
+  }
+
+  // process source vertex once per requested NFA
+  for (unsigned int n=0; n<nfa_start.size(); ++n)
+    if (nfa_used[n])
+    {
+      Product_Vertex source_product(source, nfa_start[n]);
+      Touched_Vertex* touched_vertex =
+	new Touched_Vertex(source_product, start_time, NULL_PRODUCT_VERTEX, -1);
+      push(touched_vertex);
+      vertex_info[source_product] = touched_vertex;
+    }
+  LOG4CPLUS_DEBUG(dijkstra_logger, "Initialized.");
+}
+
+
+void Multi_NFA_Dijkstra::pop()
+{
+  Shortest_Path::pop();
+
+  // the search is aborted at this vertex: it reaches no target in budget
+  NFA_Vertex* nfa_vertex = curr_touched->vertex().nfa();
+  if (!nfa_vertex->accepting() || over_budget())
+    return;
+  map<Network_Vertex*, vector<unsigned int> >::iterator it =
+    targets_at.find(curr_touched->vertex().network());
+  if (it == targets_at.end())
+    return;
+  for (unsigned int i=0; i<it->second.size(); ++i)
+  {
+    unsigned int target = it->second[i];
+    if (target_reached[target] == NULL &&
+	target_nfa[target] == nfa_tag[nfa_vertex->id()])
+    {
+      target_reached[target] = curr_touched;
+      --nmb_open;
+    }
+  }
+}
+
+
+void Multi_NFA_Dijkstra::reconstruct_path(Plan& plan, unsigned int target)
+{
+  LOG4CPLUS_DEBUG(dijkstra_logger, "Reconstructing path...");
+  Touched_Vertex* touched = target_reached[target];
+  if (touched != NULL)
+  {
+    while (touched->parent()!=NULL_PRODUCT_VERTEX)
+    {
+      plan.path.push_front(Location(touched->vertex().network()->external_id(),
+				    touched->dist(), touched->label()));
+      touched = vertex_info[touched->parent()];
+    }
+    plan.path.push_front(Location(touched->vertex().network()->external_id(),
+				  touched->dist(), touched->label()));
+  }
+  else
+    plan.budget_exceeded = aborted;
+  LOG4CPLUS_DEBUG(dijkstra_logger, "Path reconstructed.");
+}
+
+
 #endif
@@ -0,0 +1,187 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef EDGE_COSTS_HPP
+#define EDGE_COSTS_HPP
+
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "graph.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Edge costs of one epoch, indexed by edge ID.
+/// Never changed once published.
+struct Edge_Costs
+{
+  /// Epoch (0: costs of the network file).
+  unsigned long epoch;
+
+  /// Cost of each edge.
+  vector<Cost_Function> cost;
+
+  /// Maximum speed (Euclidean length per cost), the bound of the
+  /// goal-directed engines under these costs.
+  float max_speed;
+};
+
+
+
+/// New cost of a link, identified like in the network file.
+struct Link_Cost
+{
+  long tail;
+  long head;
+  Label label;
+  Cost_Function cost;
+};
+
+
+
+/// Current edge costs of a network, replaceable while routers search it.
+/// Routers take the current epoch at the start of each query and search on
+/// it to the end (read-copy-update): an update copies the cost array,
+/// changes the copy and publishes it as the next epoch with one atomic
+/// pointer swap.  An epoch is freed when the last query holding it ends.
+/// The topology is shared by all epochs; only the costs are replaced.
+class Cost_Table
+{
+protected:
+  /// Link identifying edges.
+  struct Link_Key
+  {
+    long tail;
+    long head;
+    Label label;
+
+    bool operator==(const Link_Key& other) const
+    {
+      return tail == other.tail && head == other.head && label == other.label;
+    }
+  };
+
+  /// Hash for Link_Key.
+  struct Link_Key_Hash
+  {
+    size_t operator()(const Link_Key& key) const
+    {
+      size_t h = (size_t)key.tail * 0x9e3779b97f4a7c15ULL;
+      h ^= (size_t)key.head + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      h ^= (size_t)key.label + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  /// Edge IDs of each link (parallel edges share a link).
+  unordered_multimap<Link_Key, size_t, Link_Key_Hash> links;
+
+  /// Euclidean length of each edge.
+  vector<float> length;
+
+  /// Current epoch; accessed with atomic_load and atomic_store only.
+  shared_ptr<const Edge_Costs> current;
+
+  /// Serialises updates.
+  mutex update_lock;
+
+  /// Maximum speed under costs.
+  float max_speed(const vector<Cost_Function>& cost) const;
+
+
+public:
+  /// Constructor; epoch 0 holds the costs of the network.
+  Cost_Table(Network_Graph& network);
+
+  /// Get current epoch; hold it for as long as its costs are used.
+  shared_ptr<const Edge_Costs> get() const { return atomic_load(&current); }
+
+  /// Publish current costs with updates applied as the next epoch, whose
+  /// number is stored in epoch.  Returns false with error set (nothing
+  /// published) for an unknown link or a negative cost.
+  bool update(const vector<Link_Cost>& updates, unsigned long& epoch, string& error);
+};
+
+
+Cost_Table::Cost_Table(Network_Graph& network):
+  links(), length(network.edge_count()), current(), update_lock()
+{
+  shared_ptr<Edge_Costs> costs(new Edge_Costs);
+  costs->epoch = 0;
+  costs->cost.resize(network.edge_count());
+  for (Network_Graph::const_iterator vertex_it=network.begin();
+       vertex_it!=network.end(); vertex_it++)
+    for (Network_Vertex::Edge_It edge_it=(*vertex_it)->out_edge_begin();
+	 edge_it!=(*vertex_it)->out_edge_end(); edge_it++)
+    {
+      Network_Edge* edge = *edge_it;
+      Link_Key key = { edge->tail()->external_id(), edge->head()->external_id(),
+		       edge->label() };
+      links.insert(make_pair(key, edge->id()));
+      length[edge->id()] = euclid_dist(edge->head(), edge->tail());
+      costs->cost[edge->id()] = edge->cost();
+    }
+  costs->max_speed = max_speed(costs->cost);
+  atomic_store(&current, shared_ptr<const Edge_Costs>(costs));
+}
+
+
+float Cost_Table::max_speed(const vector<Cost_Function>& cost) const
+{
+  float speed = 0;
+  for (size_t i = 0; i < cost.size(); ++i)
+  {
+    double curr_speed = length[i] / cost[i];
+    if (curr_speed > speed)
+      speed = curr_speed;
+  }
+  return speed;
+}
+
+
+bool Cost_Table::update(const vector<Link_Cost>& updates, unsigned long& epoch, string& error)
+{
+  lock_guard<mutex> guard(update_lock);
+  shared_ptr<const Edge_Costs> old = get();
+  shared_ptr<Edge_Costs> costs(new Edge_Costs(*old));
+  for (size_t u = 0; u < updates.size(); ++u)
+  {
+    const Link_Cost& update = updates[u];
+    if (!(update.cost >= 0))
+    {
+      error = "Invalid cost " + ftos(update.cost) + " of link " + itos(update.tail)
+	+ " " + itos(update.head) + " " + itos(update.label) + ".";
+      return false;
+    }
+    Link_Key key = { update.tail, update.head, update.label };
+    auto range = links.equal_range(key);
+    if (range.first == range.second)
+    {
+      error = "Unknown link " + itos(update.tail) + " " + itos(update.head)
+	+ " " + itos(update.label) + ".";
+      return false;
+    }
+    for (auto it = range.first; it != range.second; ++it)
+      costs->cost[it->second] = update.cost;
+  }
+  costs->epoch = old->epoch + 1;
+  costs->max_speed = max_speed(costs->cost);
+  atomic_store(&current, shared_ptr<const Edge_Costs>(costs));
+  epoch = costs->epoch;
+  return true;
+}
+
+
+#endif
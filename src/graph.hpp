@@ -9,10 +9,13 @@
 #ifndef GRAPH_HPP
 #define GRAPH_HPP
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <fstream>
 #include <list>
+#include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <ext/hash_map>
@@ -37,7 +40,8 @@ typedef float Cost_Function;
 /// \todo Respect vertex labels.
 typedef int Label;
 
-/// Maximum edge label ID.
+/// Maximum edge label ID of the network files and NFA files read (bound
+/// of the labels tried by Product_Neighbor_Iterator).
 int MAX_LABEL = 0;
 
 // ----------------------------------------------------------------------------
@@ -127,15 +131,21 @@ protected:
   /// Edge cost.
   Cost_Function edge_cost;
 
+  /// Edge ID (position in the network file).
+  size_t edge_id;
+
 
 public:
   /// Constructor.
   Network_Edge(Network_Vertex* const t, Network_Vertex* const h,
-	       const Label& l, const Cost_Function& c):
-    Edge<Network_Vertex>(t, h, l), edge_cost(c) {}
+	       const Label& l, const Cost_Function& c, size_t i = 0):
+    Edge<Network_Vertex>(t, h, l), edge_cost(c), edge_id(i) {}
 
   /// Get edge cost.
   Cost_Function cost() const { return edge_cost; }
+
+  /// Get edge ID.
+  size_t id() const { return edge_id; }
 };
 
 
@@ -173,6 +183,8 @@ protected:
   /// and the one-edge-past-the-last-one with label l, by edge_pointers[l+1].
   /// (If there are no edges with label l,
   /// then we have edge_pointers[l] == edge_pointers[l+1].)
+  /// Pointers go up to the largest label of the vertex plus one, so that
+  /// labels of graphs loaded later do not invalidate them.
   vector<Edge_It> edge_pointers;
 
 
@@ -191,15 +203,18 @@ public:
   /// Get first outgoing edge with given label.
   Edge_It out_edge_begin(const Label& label = 0) const
   {
-    return edge_pointers[label];
+    return (size_t)label < edge_pointers.size() ? edge_pointers[label] : out_edges.end();
   }
 
   /// Get edge past last outgoing edge with given label.
-  Edge_It out_edge_end(const Label& label = MAX_LABEL) const
+  Edge_It out_edge_end(const Label& label) const
   {
-    return edge_pointers[label+1];
+    return (size_t)label + 1 < edge_pointers.size() ? edge_pointers[label+1] : out_edges.end();
   }
 
+  /// Get edge past last outgoing edge.
+  Edge_It out_edge_end() const { return out_edges.end(); }
+
   /// Add outgoing edge.
   /// \todo Vector instead of list and better sorting method.
   void add_edge(EDGE_TYPE*);
@@ -238,7 +253,7 @@ void Vertex<EDGE_TYPE>::add_edge(EDGE_TYPE* edge)
 template<typename EDGE_TYPE>
 void Vertex<EDGE_TYPE>::set_edge_pointers()
 {
-  edge_pointers.resize(MAX_LABEL+2);
+  edge_pointers.resize(out_edges.empty() ? 1 : out_edges.back()->label() + 2);
   Edge_It it = out_edges.begin();
   Label curr_label = 0;
   while (it != out_edges.end())
@@ -250,7 +265,7 @@ void Vertex<EDGE_TYPE>::set_edge_pointers()
   }
 
   // set pointers for labels after last label used
-  for (Label same_label=curr_label; same_label<=MAX_LABEL+1; ++same_label)
+  for (Label same_label=curr_label; (size_t)same_label<edge_pointers.size(); ++same_label)
     edge_pointers[same_label] = it;
 }
 
@@ -324,11 +339,19 @@ protected:
   /// Marker for accepting state.
   bool accepting_state;
 
+  /// Labels of the outgoing transitions, one bit per label (not owned;
+  /// NULL if unknown).
+  const uint64_t* label_mask;
+
+  /// Number of words of the label bitmask.
+  unsigned label_words;
+
 
 public:
   /// Constructor.
   NFA_Vertex(long i, bool s, bool a):
-    Vertex<NFA_Edge>(i), start_state(s), accepting_state(a) {}
+    Vertex<NFA_Edge>(i), start_state(s), accepting_state(a),
+    label_mask(NULL), label_words(0) {}
 
   /// Is start state?
   bool start() const { return start_state; }
@@ -336,6 +359,36 @@ public:
   /// Is accepting state?
   bool accepting() const { return accepting_state; }
 
+  /// Set label bitmask of the outgoing transitions (not owned).
+  void set_label_mask(const uint64_t* mask, unsigned words)
+  {
+    label_mask = mask;
+    label_words = words;
+  }
+
+  /// Get label bitmask (NULL if unknown).
+  const uint64_t* labels() const { return label_mask; }
+
+  /// Get number of words of the label bitmask.
+  unsigned nmb_label_words() const { return label_words; }
+
+  /// Get first label from label on with outgoing transitions, or
+  /// MAX_LABEL+1 if there is none.  Without bitmask, label itself.
+  Label next_label(Label label) const
+  {
+    if (label_mask == NULL)
+      return label;
+    for (unsigned word = label >> 6; word < label_words; ++word)
+    {
+      uint64_t bits = label_mask[word];
+      if (word == (unsigned)(label >> 6))
+	bits &= ~(uint64_t)0 << (label & 63);
+      if (bits)
+	return min((Label)(word * 64 + __builtin_ctzll(bits)), MAX_LABEL + 1);
+    }
+    return MAX_LABEL + 1;
+  }
+
   /// Return info string.
   string info() { return itos(vertex_id); }
 };
@@ -469,8 +522,7 @@ public:
   Product_Neighbor_Iterator(Product_Vertex const t):
     tail_vertex(t), head_vertex(NULL_PRODUCT_VERTEX), curr_label()
   {
-    while (valid() && !tail_vertex.label_shared(curr_label))
-      ++curr_label;
+    skip_labels();
     network_it = tail_vertex.network()->out_edge_begin(curr_label);
     nfa_it = tail_vertex.nfa()->out_edge_begin(curr_label);
     if (valid())
@@ -483,6 +535,17 @@ public:
     return curr_label <= MAX_LABEL;
   }
 
+  /// Advance to the first label from the current one on that is shared
+  /// by the network and the NFA vertex; the label bitmask of the NFA
+  /// vertex skips labels without transitions.
+  void skip_labels()
+  {
+    const NFA_Vertex* nfa_vertex = tail_vertex.nfa();
+    curr_label = nfa_vertex->next_label(curr_label);
+    while (valid() && !tail_vertex.label_shared(curr_label))
+      curr_label = nfa_vertex->next_label(curr_label + 1);
+  }
+
   /// Increment-operator.
   void operator++()
   {
@@ -495,9 +558,8 @@ public:
       ++nfa_it;
       if (nfa_it == nfa_vertex->out_edge_end(curr_label))
       {
-	do
-	  ++curr_label;
-	while (valid() && !tail_vertex.label_shared(curr_label));
+	++curr_label;
+	skip_labels();
 	if (valid())
 	{
 	  network_it = network_vertex->out_edge_begin(curr_label);
@@ -665,13 +727,17 @@ protected:
   /// Mapping from external to internal vertex ID's.
   hash_map<long, long> internal_vertex_id;
 
+  /// Number of edge IDs in use.
+  size_t nmb_edges;
+
 
 public:
   /// Standard constructor.
-  Network_Graph(): Graph<Network_Vertex>(), internal_vertex_id() {}
+  Network_Graph(): Graph<Network_Vertex>(), internal_vertex_id(), nmb_edges(0) {}
 
   /// Constructor.
-  Network_Graph(const string network_filename, const string coords_filename)
+  Network_Graph(const string network_filename, const string coords_filename):
+    nmb_edges(0)
   {
     read_graph(network_filename);
     read_coordinates(coords_filename);
@@ -694,14 +760,42 @@ public:
     return internal_vertex_id.find(ext)->second;
   }
 
+  /// Is there a vertex with given external ID?
+  bool contains(long ext) const
+  {
+    hash_map<long, long>::const_iterator it = internal_vertex_id.find(ext);
+    return it != internal_vertex_id.end() && it->second != 0;
+  }
+
+  /// Get internal ID, 0 if there is no vertex with given external ID.
+  long find_internal_id(long ext) const
+  {
+    hash_map<long, long>::const_iterator it = internal_vertex_id.find(ext);
+    return it != internal_vertex_id.end() ? it->second : 0;
+  }
+
   /// Add vertex if none such exists yet.
   /// Internal vertex ID 0 (default value of hash_map) indicates "no entry".
   Network_Vertex* add_vertex(long ext);
 
+  /// Get number of edge IDs (edges are numbered 0, 1, ... in file order).
+  size_t edge_count() const { return nmb_edges; }
+
+  /// Add edge with the next edge ID.
   Network_Edge* add_edge(Network_Vertex* const tail_vertex,
 			 Network_Vertex* const head_vertex,
 			 const Label& label,
-			 const Cost_Function& cost);
+			 const Cost_Function& cost)
+  {
+    return add_edge(tail_vertex, head_vertex, label, cost, nmb_edges);
+  }
+
+  /// Add edge with given edge ID.
+  Network_Edge* add_edge(Network_Vertex* const tail_vertex,
+			 Network_Vertex* const head_vertex,
+			 const Label& label,
+			 const Cost_Function& cost,
+			 size_t id);
 
   /// Read graph.
   /// File format: list of edges:
@@ -736,10 +830,13 @@ Network_Vertex* Network_Graph::add_vertex(long ext)
 Network_Edge* Network_Graph::add_edge(Network_Vertex* const tail_vertex,
 				      Network_Vertex* const head_vertex,
 				      const Label& label,
-				      const Cost_Function& cost)
+				      const Cost_Function& cost,
+				      size_t id)
 {
+  if (id >= nmb_edges)
+    nmb_edges = id + 1;
   Network_Edge* new_edge =
-    new Network_Edge(tail_vertex, head_vertex, label, cost);
+    new Network_Edge(tail_vertex, head_vertex, label, cost, id);
   tail_vertex->add_edge(new_edge);
   return new_edge;
 }
@@ -824,7 +921,9 @@ void Network_Graph::construct_back_graph(Network_Graph& back_graph,
     {
       Network_Vertex* from = back_vertex[(*edge_it)->head()];
       Network_Vertex* to = back_vertex[(*edge_it)->tail()];
-      back_graph.add_edge(from, to, (*edge_it)->label(), (*edge_it)->cost());
+      // reversed edges keep their IDs, so they share edge cost tables
+      back_graph.add_edge(from, to, (*edge_it)->label(), (*edge_it)->cost(),
+			  (*edge_it)->id());
 
     }
   }
@@ -844,24 +943,46 @@ protected:
   /// Accepting states.
   list<NFA_Vertex*> accepting_states;
 
+  /// Error of reading the automaton file (empty if none).
+  string read_error;
+
+  /// Delete states and transitions after a failed read.
+  void discard();
+
 
 public:
   /// Standard constructor.
-  NFA_Graph(): Graph<NFA_Vertex>(), start_states(), accepting_states() {}
+  NFA_Graph(): Graph<NFA_Vertex>(), start_states(), accepting_states(), read_error() {}
 
-  /// Constructor.
+  /// Constructor; see error() for a file that could not be read.
   NFA_Graph(const string nfa_filename, Network_Graph& network)
   {
-    read_graph(nfa_filename);
-    set_edge_pointers();
+    if (read_graph(nfa_filename))
+    {
+      set_edge_pointers();
+      prune();
+    }
   }
 
+  /// Get error of reading the automaton file (empty if none).
+  const string& error() const { return read_error; }
+
   /// Get start state.
   list<NFA_Vertex*> start() const { return start_states; }
 
   /// Get accepting states.
   list<NFA_Vertex*> accepting() const { return accepting_states; }
 
+  /// Get largest transition label (-1 without transitions).
+  Label max_label() const
+  {
+    Label largest = -1;
+    for (const_iterator it=begin(); it!=end(); ++it)
+      if ((*it)->out_edge_begin() != (*it)->out_edge_end())
+	largest = max(largest, (*prev((*it)->out_edge_end()))->label());
+    return largest;
+  }
+
   /// Add vertex.
   NFA_Vertex* add_vertex(const long id, bool s, bool a);
 
@@ -885,12 +1006,30 @@ public:
   ///   tail_id head_id label
   ///   ...
   /// CAVE: ID's must be 0..nmb_states-1.
-  void read_graph(string nfa_filename);
+  /// Returns false, with error message and without states, if the file
+  /// cannot be opened or is malformed.
+  bool read_graph(string nfa_filename);
 
   /// Construct backward graph.
   void construct_back_graph(NFA_Graph& back_graph,
 			    map<NFA_Vertex*, NFA_Vertex*>& back_vertex,
 			    map<NFA_Vertex*, NFA_Vertex*>& orig_vertex);
+
+  /// Remove useless states and merge equivalent states.
+  /// Useless states are unreachable from the start states or cannot reach
+  /// an accepting state; start states are kept regardless.  Equivalent
+  /// states have the same acceptance and the same labeled transitions into
+  /// equivalent states (forward bisimulation), so the accepted language is
+  /// unchanged.  States are renumbered 0..size()-1 and edge pointers reset.
+  /// The backward graph of a pruned automaton has no useless states either;
+  /// it is not merged, as Bi_Dijkstra relies on a one-to-one state mapping.
+  void prune();
+
+  /// Append a disjoint copy of another automaton.
+  /// State ID's of the copy are shifted by the current number of states.
+  /// Edge pointers have to be set once all copies have been added.
+  /// Returns the copy of the (first) start state.
+  NFA_Vertex* add_disjoint(const NFA_Graph& nfa);
 };
 
 
@@ -902,11 +1041,32 @@ NFA_Vertex* NFA_Graph::add_vertex(const long id, bool s, bool a)
 }
 
 
-void NFA_Graph::read_graph(const string nfa_filename)
+void NFA_Graph::discard()
+{
+  for (iterator it=vertices.begin(); it!=vertices.end(); ++it)
+    if (*it)
+    {
+      (*it)->set_edge_pointers();
+      for (NFA_Vertex::Edge_It edge_it=(*it)->out_edge_begin();
+	   edge_it!=(*it)->out_edge_end(); ++edge_it)
+	delete *edge_it;
+      delete *it;
+    }
+  vertices.clear();
+  start_states.clear();
+  accepting_states.clear();
+}
+
+
+bool NFA_Graph::read_graph(const string nfa_filename)
 {
   ifstream nfa_file(nfa_filename.c_str());
   if( !nfa_file )
+  {
     LOG4CPLUS_ERROR(graph_logger, "NFA_Graph: unable to open file " + nfa_filename + ". Have you adapted the main NFA file to the current machine?");
+    read_error = "could not open the NFA file " + nfa_filename + ".";
+    return false;
+  }
 
   string header;
   int num_states;
@@ -916,14 +1076,24 @@ void NFA_Graph::read_graph(const string nfa_filename)
 
   // read states
   nfa_file >> num_states;
+  if (!nfa_file || num_states < 0)
+  {
+    read_error = "the NFA file " + nfa_filename + " has no number of states.";
+    return false;
+  }
   LOG4CPLUS_INFO(graph_logger, "NFA has " + itos(num_states) + " states.");
   getline(nfa_file, header);
   getline(nfa_file, header);
-  vertices = vector<NFA_Vertex*>(num_states);
+  vertices = vector<NFA_Vertex*>(num_states, (NFA_Vertex*)NULL);
   for (int i=0; i<num_states; ++i)
   {
     nfa_file >> id >> start >> accepting;
-    assert (i == id);
+    if (!nfa_file || id != i)
+    {
+      discard();
+      read_error = "the NFA file " + nfa_filename + " lacks state " + itos(i) + ".";
+      return false;
+    }
     // TODO
     // NFA_Vertex* new_vertex = add_vertex(id, start, accepting);
     NFA_Vertex* new_vertex = new NFA_Vertex(id, start, accepting);
@@ -942,16 +1112,24 @@ void NFA_Graph::read_graph(const string nfa_filename)
   while (true)
   {
     nfa_file >> from_id >> to_id >> label;
-    if (label >= MAX_LABEL)
-      MAX_LABEL = label;
     if (nfa_file.good())
     {
+      if (from_id < 0 || from_id >= num_states || to_id < 0 || to_id >= num_states || label < 0)
+      {
+	discard();
+	read_error = "the NFA file " + nfa_filename + " has an invalid transition "
+	  + itos(from_id) + " " + itos(to_id) + " " + itos(label) + ".";
+	return false;
+      }
+      if (label >= MAX_LABEL)
+	MAX_LABEL = label;
       NFA_Vertex* from = vertices[from_id];
       NFA_Vertex* to = vertices[to_id];
       add_edge(from, to, label);
     }
     else break;
   }
+  return true;
 }
 
 
@@ -987,4 +1165,205 @@ void NFA_Graph::construct_back_graph(NFA_Graph& back_graph,
 }
 
 
+void NFA_Graph::prune()
+{
+  const size_t num_states = size();
+  const size_t none = (size_t)-1;
+
+  // reachability from start states and to accepting states
+  vector<vector<NFA_Vertex*> > pred(num_states);
+  vector<bool> reached(num_states, false), productive(num_states, false);
+  list<NFA_Vertex*> pending(start_states);
+  for (list<NFA_Vertex*>::iterator it=pending.begin(); it!=pending.end(); ++it)
+    reached[(*it)->id()] = true;
+  while (!pending.empty())
+  {
+    NFA_Vertex* vertex = pending.front();
+    pending.pop_front();
+    for (NFA_Vertex::Edge_It edge_it=vertex->out_edge_begin();
+	 edge_it!=vertex->out_edge_end(); ++edge_it)
+    {
+      NFA_Vertex* head = (*edge_it)->head();
+      pred[head->id()].push_back(vertex);
+      if (!reached[head->id()])
+      {
+	reached[head->id()] = true;
+	pending.push_back(head);
+      }
+    }
+  }
+  pending = accepting_states;
+  for (list<NFA_Vertex*>::iterator it=pending.begin(); it!=pending.end(); ++it)
+    productive[(*it)->id()] = reached[(*it)->id()];
+  while (!pending.empty())
+  {
+    NFA_Vertex* vertex = pending.front();
+    pending.pop_front();
+    if (!reached[vertex->id()])
+      continue;
+    for (size_t i=0; i<pred[vertex->id()].size(); ++i)
+      if (!productive[pred[vertex->id()][i]->id()])
+      {
+	productive[pred[vertex->id()][i]->id()] = true;
+	pending.push_back(pred[vertex->id()][i]);
+      }
+  }
+
+  // initial partition: kept states by acceptance
+  // (the first round always refines; later rounds stop once stable)
+  vector<size_t> state_class(num_states, none);
+  size_t num_classes = none;
+  for (size_t i=0; i<num_states; ++i)
+    if (productive[i] || vertices[i]->start())
+      state_class[i] = vertices[i]->accepting() ? 1 : 0;
+
+  // refine by transitions into classes until stable
+  typedef pair<size_t, vector<pair<Label, size_t> > > Signature;
+  while (true)
+  {
+    map<Signature, size_t> class_of;
+    vector<size_t> new_class(num_states, none);
+    for (size_t i=0; i<num_states; ++i)
+    {
+      if (state_class[i] == none)
+	continue;
+      Signature signature;
+      signature.first = state_class[i];
+      for (NFA_Vertex::Edge_It edge_it=vertices[i]->out_edge_begin();
+	   edge_it!=vertices[i]->out_edge_end(); ++edge_it)
+	if (productive[(*edge_it)->head()->id()])
+	  signature.second.push_back(make_pair((*edge_it)->label(),
+					       state_class[(*edge_it)->head()->id()]));
+      sort(signature.second.begin(), signature.second.end());
+      signature.second.erase(unique(signature.second.begin(),
+				    signature.second.end()),
+			     signature.second.end());
+      map<Signature, size_t>::iterator it = class_of.find(signature);
+      if (it == class_of.end())
+	it = class_of.insert(make_pair(signature, class_of.size())).first;
+      new_class[i] = it->second;
+    }
+    bool stable = (class_of.size() == num_classes);
+    state_class = new_class;
+    num_classes = class_of.size();
+    if (stable)
+      break;
+  }
+
+  // build quotient automaton
+  vector<NFA_Vertex*> old_vertices;
+  old_vertices.swap(vertices);
+  start_states.clear();
+  accepting_states.clear();
+  vector<bool> is_start(num_classes, false), is_accepting(num_classes, false);
+  for (size_t i=0; i<num_states; ++i)
+    if (state_class[i] != none)
+    {
+      is_start[state_class[i]] = is_start[state_class[i]] || old_vertices[i]->start();
+      is_accepting[state_class[i]] = old_vertices[i]->accepting();
+    }
+  for (size_t c=0; c<num_classes; ++c)
+  {
+    NFA_Vertex* new_vertex = add_vertex(c, is_start[c], is_accepting[c]);
+    if (is_start[c])
+      add_start(new_vertex);
+    if (is_accepting[c])
+      add_accepting(new_vertex);
+  }
+
+  vector<bool> class_done(num_classes, false);
+  for (size_t i=0; i<num_states; ++i)
+  {
+    size_t c = state_class[i];
+    if (c != none && !class_done[c])
+    {
+      class_done[c] = true;
+      vector<pair<Label, size_t> > transitions;
+      for (NFA_Vertex::Edge_It edge_it=old_vertices[i]->out_edge_begin();
+	   edge_it!=old_vertices[i]->out_edge_end(); ++edge_it)
+	if (productive[(*edge_it)->head()->id()])
+	  transitions.push_back(make_pair((*edge_it)->label(),
+					  state_class[(*edge_it)->head()->id()]));
+      sort(transitions.begin(), transitions.end());
+      transitions.erase(unique(transitions.begin(), transitions.end()),
+			transitions.end());
+      for (size_t t=0; t<transitions.size(); ++t)
+	add_edge(vertices[c], vertices[transitions[t].second],
+		 transitions[t].first);
+    }
+  }
+
+  for (size_t i=0; i<num_states; ++i)
+  {
+    for (NFA_Vertex::Edge_It edge_it=old_vertices[i]->out_edge_begin();
+	 edge_it!=old_vertices[i]->out_edge_end(); ++edge_it)
+      delete *edge_it;
+    delete old_vertices[i];
+  }
+  set_edge_pointers();
+
+  if (num_classes != num_states)
+    LOG4CPLUS_INFO(graph_logger, "NFA pruned from " + itos(num_states) + " to "
+		   + itos(num_classes) + " states.");
+}
+
+
+NFA_Vertex* NFA_Graph::add_disjoint(const NFA_Graph& nfa)
+{
+  const long offset = size();
+  for (const_iterator vertex_it=nfa.begin(); vertex_it!=nfa.end(); ++vertex_it)
+  {
+    bool is_start = (*vertex_it)->start();
+    bool is_accepting = (*vertex_it)->accepting();
+    NFA_Vertex* new_vertex =
+      add_vertex(offset + (*vertex_it)->id(), is_start, is_accepting);
+    new_vertex->set_label_mask((*vertex_it)->labels(), (*vertex_it)->nmb_label_words());
+    if (is_start)
+      add_start(new_vertex);
+    if (is_accepting)
+      add_accepting(new_vertex);
+  }
+
+  for (const_iterator vertex_it=nfa.begin(); vertex_it!=nfa.end(); ++vertex_it)
+  {
+    for (NFA_Vertex::Edge_It edge_it=(*vertex_it)->out_edge_begin();
+	 edge_it!=(*vertex_it)->out_edge_end(); ++edge_it)
+      add_edge(vertices[offset + (*edge_it)->tail()->id()],
+	       vertices[offset + (*edge_it)->head()->id()],
+	       (*edge_it)->label());
+  }
+  return vertices[offset + nfa.start().front()->id()];
+}
+
+
+// ----------------------------------------------------------------------------
+
+
+/// Backward graph with vertex mappings to and from the original graph.
+template <class Graph_Type, class Vertex_Type>
+struct Back_Graph
+{
+  /// Graph with reversed edges.
+  Graph_Type graph;
+
+  /// Mapping from original to backward graph.
+  map<Vertex_Type*, Vertex_Type*> back_vertex;
+
+  /// Mapping from backward to original graph.
+  map<Vertex_Type*, Vertex_Type*> orig_vertex;
+
+  /// Constructor.
+  Back_Graph(Graph_Type& orig): graph(), back_vertex(), orig_vertex()
+  {
+    orig.construct_back_graph(graph, back_vertex, orig_vertex);
+  }
+};
+
+/// Backward network.
+typedef Back_Graph<Network_Graph, Network_Vertex> Back_Network;
+
+/// Backward NFA.
+typedef Back_Graph<NFA_Graph, NFA_Vertex> Back_NFA;
+
+
 #endif
@@ -0,0 +1,345 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef LINK_SEQUENCES_HPP
+#define LINK_SEQUENCES_HPP
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "graph.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Columnar link sequence file: the edges travelled by each trip.
+/// Header: magic "RRLINKS" + format version byte, number of trips n
+/// (u64), number of edge entries m (u64).  Then, little-endian:
+///
+///   u32  edges[m]        edge IDs of all trips, trip after trip
+///        (padding to a multiple of 8 bytes)
+///   u64  trip_ids[n]
+///   u64  offsets[n + 1]  edges of trip i: edges[offsets[i]..offsets[i+1])
+///
+/// Edge IDs are the positions of the links in the network (link) file,
+/// as listed by the edge map file written with it.  Trips without a plan
+/// have no edges.
+const char LINK_MAGIC[8] = { 'R', 'R', 'L', 'I', 'N', 'K', 'S', 1 };
+
+
+/// Header of a link sequence file.
+struct Link_File_Header
+{
+  char magic[8];
+  uint64_t nmb_trips;
+  uint64_t nmb_edges;
+};
+
+
+/// Get offset of the trip IDs in a link sequence file with m edge entries.
+size_t link_file_ids_offset(uint64_t m)
+{
+  return sizeof(Link_File_Header) + (m * 4 + 7) / 8 * 8;
+}
+
+
+
+/// Get edge IDs of plan; false if a step has no matching edge.
+/// Of parallel edges with the label of a step, the cheapest is taken, as
+/// by the searches.
+bool plan_edges(const Network_Graph& network, const Plan& plan, vector<uint32_t>& edges)
+{
+  edges.clear();
+  if (plan.path.empty())
+    return true;
+  list<Location>::const_iterator it = plan.path.begin();
+  Network_Vertex* tail = network[network.find_internal_id(it->external_id)];
+  for (++it; it != plan.path.end(); ++it)
+  {
+    Network_Edge* best = NULL;
+    for (Network_Vertex::Edge_It edge_it = tail->out_edge_begin();
+	 edge_it != tail->out_edge_end(); edge_it++)
+      if ((*edge_it)->head()->external_id() == it->external_id &&
+	  (*edge_it)->label() == it->edge_label &&
+	  (best == NULL || (*edge_it)->cost() < best->cost()))
+	best = *edge_it;
+    if (best == NULL)
+      return false;
+    edges.push_back(best->id());
+    tail = best->head();
+  }
+  return true;
+}
+
+
+/// Append a trip record (trip ID, number of edges, edge IDs) for
+/// Link_Sequence_File.
+void append_link_record(string& out, unsigned long id, const vector<uint32_t>& edges)
+{
+  uint64_t trip_id = id;
+  uint32_t size = edges.size();
+  out.append((const char*)&trip_id, 8);
+  out.append((const char*)&size, 4);
+  out.append((const char*)edges.data(), edges.size() * 4);
+}
+
+
+/// Write edge map: edge ID, tail, head and label of each edge.
+bool write_edge_map(const char* filename, const Network_Graph& network)
+{
+  vector<Network_Edge*> edges(network.edge_count());
+  for (Network_Graph::const_iterator vertex_it = network.begin();
+       vertex_it != network.end(); vertex_it++)
+    for (Network_Vertex::Edge_It edge_it = (*vertex_it)->out_edge_begin();
+	 edge_it != (*vertex_it)->out_edge_end(); edge_it++)
+      edges[(*edge_it)->id()] = *edge_it;
+
+  ofstream out(filename);
+  out << "edge_id\ttail\thead\tlabel\n";
+  for (size_t e = 0; e < edges.size(); ++e)
+    if (edges[e])
+      out << e << '\t' << edges[e]->tail()->external_id() << '\t'
+	  << edges[e]->head()->external_id() << '\t' << edges[e]->label() << '\n';
+  out.close();
+  return !out.fail();
+}
+
+
+
+/// Stream buffer turning trip records (append_link_record) into a link
+/// sequence file.  Edges go to the file as they arrive; trip IDs and
+/// offsets are kept (16 bytes per trip) and written when finished.
+class Link_Sequence_Buffer : public streambuf
+{
+protected:
+  /// Link sequence file.
+  ofstream file;
+
+  /// Incomplete record.
+  string pending;
+
+  /// Trip IDs.
+  vector<uint64_t> ids;
+
+  /// Edge offsets of the trips.
+  vector<uint64_t> offsets;
+
+  /// Write complete records at the start of data; returns their size.
+  size_t consume(const char* data, size_t size);
+
+  /// Consume complete records of pending.
+  bool consume_pending()
+  {
+    pending.erase(0, consume(pending.data(), pending.size()));
+    return (bool)file;
+  }
+
+  int overflow(int c)
+  {
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+      pending.push_back(traits_type::to_char_type(c));
+    return consume_pending() ? traits_type::not_eof(c) : traits_type::eof();
+  }
+
+  streamsize xsputn(const char* data, streamsize size)
+  {
+    // chunks hold whole records, so pending is usually empty
+    if (!pending.empty())
+    {
+      pending.append(data, size);
+      return consume_pending() ? size : 0;
+    }
+    size_t used = consume(data, size);
+    pending.assign(data + used, size - used);
+    return file ? size : 0;
+  }
+
+
+public:
+  /// Constructor.
+  Link_Sequence_Buffer(): file(), pending(), ids(), offsets(1, 0) {}
+
+  /// Open file.
+  bool open(const char* filename)
+  {
+    file.open(filename, ios::binary);
+    Link_File_Header header = { {0}, 0, 0 };
+    file.write((const char*)&header, sizeof(header));
+    return (bool)file;
+  }
+
+  /// Write trip IDs, offsets and header, and close the file.
+  bool finish();
+};
+
+
+size_t Link_Sequence_Buffer::consume(const char* data, size_t size)
+{
+  size_t position = 0;
+  while (size - position >= 12)
+  {
+    uint64_t id;
+    uint32_t length;
+    memcpy(&id, data + position, 8);
+    memcpy(&length, data + position + 8, 4);
+    if (size - position - 12 < (size_t)length * 4)
+      break;
+    file.write(data + position + 12, (size_t)length * 4);
+    ids.push_back(id);
+    offsets.push_back(offsets.back() + length);
+    position += 12 + (size_t)length * 4;
+  }
+  return position;
+}
+
+
+bool Link_Sequence_Buffer::finish()
+{
+  if (!file.is_open())
+    return true;
+  bool ok = pending.empty();
+  uint64_t nmb_edges = offsets.back();
+  static const char padding[8] = { 0 };
+  file.write(padding, link_file_ids_offset(nmb_edges) - sizeof(Link_File_Header) - nmb_edges * 4);
+  file.write((const char*)ids.data(), ids.size() * 8);
+  file.write((const char*)offsets.data(), offsets.size() * 8);
+
+  Link_File_Header header;
+  memcpy(header.magic, LINK_MAGIC, 8);
+  header.nmb_trips = ids.size();
+  header.nmb_edges = nmb_edges;
+  file.seekp(0);
+  file.write((const char*)&header, sizeof(header));
+  file.close();
+  return ok && !file.fail();
+}
+
+
+
+/// Output stream writing trip records to a link sequence file.
+class Link_Sequence_File : public ostream
+{
+protected:
+  /// Stream buffer.
+  Link_Sequence_Buffer buffer;
+
+
+public:
+  /// Constructor.
+  Link_Sequence_File(): ostream(NULL), buffer() {}
+
+  /// Open file; failbit is set on error.
+  void open(const char* filename)
+  {
+    if (buffer.open(filename))
+      rdbuf(&buffer);
+    else
+      setstate(ios::failbit);
+  }
+
+  /// Finish file; false if data could not be written.
+  bool close()
+  {
+    bool ok = buffer.finish();
+    rdbuf(NULL);
+    return ok;
+  }
+};
+
+
+
+/// Read-only view of a mapped link sequence file.
+class Link_Sequences
+{
+protected:
+  /// Mapping.
+  void* mapping;
+
+  /// Size of mapping.
+  size_t size;
+
+  /// Header.
+  Link_File_Header header;
+
+  /// Columns.
+  const uint32_t* edges;
+  const uint64_t* ids;
+  const uint64_t* offsets;
+
+
+public:
+  /// Constructor.
+  Link_Sequences(): mapping(NULL), size(0), header(), edges(NULL), ids(NULL), offsets(NULL) {}
+
+  /// Destructor.
+  ~Link_Sequences()
+  {
+    if (mapping)
+      munmap(mapping, size);
+  }
+
+  /// Map file; false if it is missing or no link sequence file.
+  bool open(const char* filename);
+
+  /// Get number of trips.
+  size_t nmb_trips() const { return header.nmb_trips; }
+
+  /// Get ID of trip i.
+  uint64_t trip_id(size_t i) const { return ids[i]; }
+
+  /// Get edge IDs [begin, end) of trip i.
+  const uint32_t* begin(size_t i) const { return edges + offsets[i]; }
+  const uint32_t* end(size_t i) const { return edges + offsets[i + 1]; }
+};
+
+
+bool Link_Sequences::open(const char* filename)
+{
+  int fd = ::open(filename, O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(header))
+  {
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  size = status.st_size;
+  mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    mapping = NULL;
+    return false;
+  }
+  const char* data = (const char*)mapping;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, LINK_MAGIC, 8) != 0 || header.nmb_trips > size ||
+      header.nmb_edges > size ||
+      size != link_file_ids_offset(header.nmb_edges) + (2 * header.nmb_trips + 1) * 8)
+    return false;
+  edges = (const uint32_t*)(data + sizeof(header));
+  ids = (const uint64_t*)(data + link_file_ids_offset(header.nmb_edges));
+  offsets = ids + header.nmb_trips;
+  return offsets[header.nmb_trips] == header.nmb_edges;
+}
+
+
+#endif
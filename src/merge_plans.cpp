@@ -0,0 +1,135 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  Merge plan files of several shards into one plan file sorted by trip ID.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+
+/// Get trip ID of a plan line.
+unsigned long trip_id(const string& line)
+{
+  return strtoul(line.c_str(), NULL, 10);
+}
+
+
+/// Is plan file sorted by trip ID?
+bool sorted_by_id(const char* filename)
+{
+  ifstream in(filename);
+  string line;
+  unsigned long last = 0;
+  bool first = true;
+  while (getline(in, line))
+  {
+    unsigned long id = trip_id(line);
+    if (!first && id < last)
+      return false;
+    last = id;
+    first = false;
+  }
+  return true;
+}
+
+
+/// Merge sorted plan files (k-way merge, ties in order of the files).
+void merge_sorted(const vector<char*>& inputs, ostream& out)
+{
+  typedef pair<unsigned long, size_t> Head;
+  priority_queue<Head, vector<Head>, greater<Head> > heads;
+  vector<ifstream*> streams;
+  vector<string> lines(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i)
+  {
+    streams.push_back(new ifstream(inputs[i]));
+    if (getline(*streams[i], lines[i]))
+      heads.push(Head(trip_id(lines[i]), i));
+  }
+
+  while (!heads.empty())
+  {
+    size_t i = heads.top().second;
+    heads.pop();
+    out << lines[i] << '\n';
+    if (getline(*streams[i], lines[i]))
+      heads.push(Head(trip_id(lines[i]), i));
+  }
+
+  for (size_t i = 0; i < streams.size(); ++i)
+    delete streams[i];
+}
+
+
+/// Merge plan files in memory (for unsorted inputs).
+void merge_unsorted(const vector<char*>& inputs, ostream& out)
+{
+  vector<pair<unsigned long, string> > lines;
+  for (size_t i = 0; i < inputs.size(); ++i)
+  {
+    ifstream in(inputs[i]);
+    string line;
+    while (getline(in, line))
+      lines.push_back(make_pair(trip_id(line), line));
+  }
+  stable_sort(lines.begin(), lines.end(),
+	      [](const pair<unsigned long, string>& a,
+		 const pair<unsigned long, string>& b) { return a.first < b.first; });
+  for (size_t i = 0; i < lines.size(); ++i)
+    out << lines[i].second << '\n';
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    cout << "Usage:" << endl
+	 << " merge_plans <output> <plans>..." << endl
+	 << " Merges plan files (e.g. of new_main --shard i/N) into one file sorted"
+	 << " by trip ID." << endl
+	 << " Sorted inputs (new_main -k on a trip file sorted by ID) are merged"
+	 << " in a single pass, others are sorted in memory." << endl;
+    return 0;
+  }
+
+  vector<char*> inputs(argv + 2, argv + argc);
+  bool sorted = true;
+  for (size_t i = 0; i < inputs.size(); ++i)
+  {
+    if (!ifstream(inputs[i]))
+    {
+      cout << "Sorry, could not open file " << inputs[i] << ". Bye!" << endl;
+      exit(-1);
+    }
+    sorted = sorted && sorted_by_id(inputs[i]);
+  }
+
+  ofstream out(argv[1]);
+  if (!out)
+  {
+    cout << "Sorry, could not open file " << argv[1] << ". Bye!" << endl;
+    exit(-1);
+  }
+  if (sorted)
+    merge_sorted(inputs, out);
+  else
+  {
+    cout << "Inputs are not sorted by trip ID; sorting in memory." << endl;
+    merge_unsorted(inputs, out);
+  }
+  return 0;
+}
@@ -7,7 +7,10 @@
   %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
  */
 
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <getopt.h>
 #include <iostream>
 #include <fstream>
 #include <thread>
@@ -15,11 +18,25 @@
 #include <string>
 #include <utility>
 
+#include "checkpoint.hpp"
 #include "dijkstra.hpp"
 #include "graph.hpp"
+#include "link_sequences.hpp"
+#include "nfa_bundle.hpp"
+#include "nfa_compiler.hpp"
+#include "numa.hpp"
+#include "output_file.hpp"
+#include "plan_format.hpp"
+#include "plan_text.hpp"
+#include "plan_writer.hpp"
+#include "route_server.hpp"
+#include "routing_context.hpp"
 #include "timer.hpp"
 #include "tools.hpp"
+#include "trip_batch.hpp"
+#include "trip_loader.hpp"
 #include "ReadRouteRequestFile.hpp"
+#include "work_pool.hpp"
 
 #include <log4cplus/layout.h>
 #include <log4cplus/logger.h>
@@ -31,175 +48,387 @@ using namespace log4cplus;
 Event_Handler event_handler;
 char glob = 'a';
 std::mutex mtx;
-std::mutex mtx1;
 
 /// Logger.
 Logger main_logger = Logger::getInstance("Router");
 
+/// Write plans in the binary plan format?
+bool binary_plans = false;
+
+/// Time quantum of the binary plan format.
+double plan_time_quantum = PLAN_TIME_QUANTUM;
+
+/// Network whose edges are written as link sequences instead of plans
+/// (NULL: plans are written).
+const Network_Graph *link_network = NULL;
+
 istream &operator>>(istream &in, Trip_Request &request)
 {
   in >> request.source >> request.destination >> request.start_time;
   return in;
 }
 
-/// Plan output operator.
-ostream &operator<<(ostream &out, Plan &plan)
-{
-  const unsigned int plan_size = plan.path.size();
-  out << plan_size << '\t';
-
-  if (plan_size == 0) // No plan
-    return out;
-  else
-  {
-    for (Plan_Iterator it = plan.path.begin(); it != plan.path.end(); ++it)
-    {
-      out << it->external_id << '\t' << it->time << "\t";
-
-      // link ID travelled added.
-      if (it != plan.path.begin())
-        out << it->edge_label << '\t';
-    }
-  }
-  return out;
-}
-
 //Condensed
 void print_usage()
 {
   cout << "Usage:" << endl
        << " Router [-g <graph>] [-c <coords>] [-N <NFAFILE>]" << endl
-       << "        ([-t <time>] | [-f <pairs>] )" << endl
+       << "        [-f <pairs>]" << endl
        << "        " << endl
+       << " -a <algorithm> shortest path algorithm (0=Dijkstra|1=Goal|2=Bi|3=G+B)" << endl
+       << " -A           pin worker threads to cores, spread over NUMA nodes" << endl
+       << " -b <trips>   trips per work batch (default 64)" << endl
        << " -c <coords>  coordinates (vertex) file" << endl
-       << " -f <pairs>   pairs from file" << endl
+       << " -f <pairs>   pairs from file (text, or binary made by trips_to_binary)" << endl
        << " -g <graph>   graph (edge) file" << endl
-       << " -N <NFAFile> file specifying nfa collection" << endl
-       << " -s <core count> specifying how many cores used" << endl
-       << " -t <time>    time of departure" << endl
-       << " -F <request-input-output-file>" << endl;
+       << " -N <NFAFile> file specifying nfa collection (NFA files or re:<expression>)," << endl
+       << "             or NFA bundle written by nfas_to_bundle" << endl
+       << " -k           keep input order of trips in results (default: routing order);" << endl
+       << "              duplicates and common origins are then only found within a batch" << endl
+       << " -L           route trips of each batch in space-filling-curve order of" << endl
+       << "              their source and destination (output order is unchanged)" << endl
+       << " -m <MB>      enable plan cache with given memory limit" << endl
+       << " -o <results filename> filename for results (default plans.txt)" << endl
+       << "              compressed on the writer thread if ending in .gz (gzip) or .zst" << endl
+       << " -P           stream trips from parser to workers to writer in constant memory;" << endl
+       << "              duplicates and common origins are then only found within a batch" << endl
+       << " -q <seconds> start time bucket of plan cache (default 900, 0: any time)" << endl
+       << " -R           one replica of network and NFAs per NUMA node, used by" << endl
+       << "              the workers on that node (implies -A)" << endl
+       << " -s <core count> number of worker threads (default: all cores)" << endl
+       << " -F <request-input-output-file>" << endl
+       << " --shard <i>/<N>     route only shard i of N of the trips" << endl
+       << " --shard-by <hash|range> assign trips to shards by hash of trip ID" << endl
+       << "                     (default) or by contiguous ranges of input trips" << endl
+       << " --max-time <time>   abort searches beyond this travel time" << endl
+       << " --max-settled <n>   abort searches after settling n product vertices" << endl
+       << " --max-seconds <s>   abort searches after s seconds of wall-clock time;" << endl
+       << "                     aborted trips get a budget_exceeded record" << endl
+       << " --binary            write plans in the compact binary format (see" << endl
+       << "                     plan_format.hpp; plans_to_text converts to text)" << endl
+       << " --time-quantum <s>  time resolution of binary plans (default 0.001)" << endl
+       << " --io-uring          write uncompressed plans through io_uring with several" << endl
+       << "                     large writes in flight (pwrite if unavailable)" << endl
+       << " --checkpoint <file> save progress to file and resume from it: completed" << endl
+       << "                     batches are skipped and plans appended (batch routing" << endl
+       << "                     into an uncompressed file; removed when done)" << endl
+       << " --checkpoint-interval <seconds>  time between checkpoints (default 60)" << endl
+       << " --link-sequences    write only the edges travelled by each trip, as columns" << endl
+       << "                     of edge IDs (see link_sequences.hpp), and the edge IDs" << endl
+       << "                     of the links to <results filename>.edges" << endl
+       << " --serve <socket>    keep network and NFAs loaded and route trips sent by" << endl
+       << "                     route_client over this Unix socket until shut down" << endl;
 }
 
 
 
-//Threaded trip request processing
-void thread_method(const char *pairs_filename, string_pair chunk, Network_Graph &network, unsigned int algorithm, int singleNFA, string nfa_filename, const char *nfa_collection_filename)
+/// Append the plan of a trip to out.
+void write_plan(string &out, const Trip_Request &trip_request, Plan &plan)
 {
-  Request_Handler request_handler;
-  Plan plan;
-  request_handler.set_mode(FILE_PAIRS);
-  request_handler.set_stream(pairs_filename);
-  vector<NFA_Graph *> nfaVector;
+  if (link_network)
+  {
+    static thread_local vector<uint32_t> edges;
+    if (!plan_edges(*link_network, plan, edges))
+      LOG4CPLUS_ERROR(main_logger, "No edges found for the plan of trip " + itos(trip_request.id) + ".");
+    append_link_record(out, trip_request.id, edges);
+    return;
+  }
 
-  
+  if (binary_plans)
+  {
+    encode_plan(out, trip_request.id, trip_request.source, trip_request.destination,
+                plan.budget_exceeded, plan.path.begin(), plan.path.end(), plan_time_quantum);
+    return;
+  }
+
+  append_plan_head(out, trip_request.id, trip_request.source, trip_request.destination,
+                   plan.path.size(), plan.budget_exceeded);
+  if (!plan.budget_exceeded) // No plan within the search budget otherwise
+    for (Plan_Iterator it = plan.path.begin(); it != plan.path.end(); ++it)
+      // link ID travelled added, except for the start
+      append_location(out, it->external_id, it->time, it->edge_label, it == plan.path.begin());
+  out += '\n';
+}
+
+/// NFA bundle given as NFA collection (mapped once for all replicas).
+NFA_Bundle nfa_bundle;
+
+/// Load NFAs of the single NFA file or of the NFA collection file, which
+/// may be an NFA bundle.
+void load_nfas(Network_Graph &network, int singleNFA, string nfa_filename, const char *nfa_collection_filename, vector<NFA_Graph *> &nfaVector)
+{
+  string error;
   if (singleNFA == 1)
   {
-    NFA_Graph *nfa = new NFA_Graph(nfa_filename, network);
+    NFA_Graph *nfa = load_nfa(nfa_filename, network, error);
+    if (nfa == NULL)
+    {
+      cout << "Sorry, " << error << " Bye!" << endl;
+      exit(-1);
+    }
     nfaVector.push_back(nfa);
   }
+  else if (nfa_bundle.is_open() || is_nfa_bundle(nfa_collection_filename))
+  {
+    if (!nfa_bundle.is_open() && !nfa_bundle.open(nfa_collection_filename))
+    {
+      cout << "Sorry, " << nfa_bundle.error() << " Bye!" << endl;
+      exit(-1);
+    }
+    for (unsigned int i = 0; i < nfa_bundle.nmb_nfas(); ++i)
+      nfaVector.push_back(nfa_bundle.nfa(i));
+  }
   else
   {
-    ifstream file(nfa_collection_filename);
-
-    if (!file)
+    vector<string> entries;
+    if (!read_nfa_collection(nfa_collection_filename, entries))
     {
       cout << "There was an error opening the file specifying the collection of NFAs." << endl;
       cout << "Filename given: " << nfa_collection_filename << endl;
       exit(-1);
     }
 
-    char buffer[5000];
-    file.getline(buffer, 5000, '\n');
-
-    int nNFAs;
-
-    file >> nNFAs;
-    file.get();
-
-    for (unsigned int i = 0; (int)i < nNFAs; ++i)
+    for (unsigned int i = 0; i < entries.size(); ++i)
     {
-      file.getline(buffer, 5000, '\n');
-      NFA_Graph *nfa = new NFA_Graph(buffer, network);
+      NFA_Graph *nfa = load_nfa(entries[i], network, error);
+      if (nfa == NULL)
+      {
+        cout << "Sorry, " << error << " Bye!" << endl;
+        exit(-1);
+      }
       nfaVector.push_back(nfa);
     }
   }
+}
 
-  LOG4CPLUS_DEBUG(main_logger, "Building router...");
-  Router router(network, nfaVector);
-  LOG4CPLUS_DEBUG(main_logger, "Router built.");
-
-
-  
-  //request_handler.set_network(&network);
- 
-  //request_handler.init();
-
-  //file splitting was previously based on going through these trips
-  //I have to read the file and put them into this vector of requests lol
-
-  vector<Trip_Request> trip_list = trips;
-  //TODO think about when to set up the trip request file
-  while (!trip_list.empty())
+/// Read the trips of this shard from the request files (text or binary),
+/// parsing each file with nmb_threads threads.  Exits with the malformed
+/// lines of a file.
+void read_trips(const vector<string_pair> &requestName, const Network_Graph &network, size_t nmb_nfas, unsigned int nmb_threads, Shard &shard, Trip_Batch &batch)
+{
+  const size_t max_reported = 20;
+  Trip_Loader loader(network, nmb_threads, nmb_nfas);
+  Trip_Columns trips;
+  for (size_t f = 0; f < requestName.size(); ++f)
   {
+    const char *filename = requestName[f].first.c_str();
+    if (loader.load(filename, trips))
+      continue;
+    const vector<Trip_Error> &errors = loader.errors();
+    if (errors.empty())
+    {
+      cout << "Sorry, " << loader.error() << " Bye!" << endl;
+      exit(-1);
+    }
+    for (size_t e = 0; e < errors.size() && e < max_reported; ++e)
+      cout << filename << ":" << errors[e].line << ": " << errors[e].message << endl;
+    if (errors.size() > max_reported)
+      cout << "... and " << errors.size() - max_reported << " more malformed lines." << endl;
+    cout << "Sorry, the trip file " << filename << " has malformed lines. Bye!" << endl;
+    exit(-1);
+  }
+  // an empty trip file is routed like any other and yields an empty plan file
+  if (trips.size() == 0)
+    LOG4CPLUS_WARN(main_logger, "The trip files contain no trips.");
 
-    Trip_Request trip_request = trip_list.back();
-
-    float distance = 0.0;
-
-    plan.path.clear();
-
-    double time_elapsed;
-    router.find_path((Algorithm)algorithm, trip_request /* ,request_handler.request()*/, plan,
-                     time_elapsed, trip_request.nfaID);
-    mtx1.lock();
-    out_file << trip_request.id << '\t'
-             << trip_request.source << '\t'
-             << trip_request.destination << '\t';
-
-    out_file << plan << endl;
-    mtx1.unlock();
-    
-    bool error = false;
-    string error_message = "Differing distances:  request " + itos(trip_request.source) + "--" + itos(trip_request.destination) + "  distances";
+  if (shard.by_range)
+    shard.nmb_trips = trips.size();
+  for (size_t i = 0; i < trips.size(); ++i)
+  {
+    Trip_Request trip = trips.request(i);
+    if (shard.contains(trip, i))
+      batch.trips.push_back(trip);
+  }
+}
 
-    error_message += " " + ftos(distance);
-    error_message += "  differences";
+/// Count trips of the request files.  Exits with the first malformed line.
+size_t count_trips(const vector<string_pair> &requestName, const Network_Graph &network, size_t nmb_nfas)
+{
+  size_t nmb_trips = 0;
+  Trip_Loader loader(network, 1, nmb_nfas);
+  for (size_t f = 0; f < requestName.size(); ++f)
+  {
+    Trip_Reader reader(loader);
+    Trip_Request trip;
+    if (reader.open(requestName[f].first.c_str()))
+      while (reader.next(trip))
+        ++nmb_trips;
+    if (!reader.error().empty())
+    {
+      cout << "Sorry, " << reader.error() << " Bye!" << endl;
+      exit(-1);
+    }
+  }
+  return nmb_trips;
+}
 
-    if (error)
-      LOG4CPLUS_ERROR(main_logger, error_message);
+/// Route a batch of consecutive input trips and write their plans in input order.
+/// With a locality key, bundles are routed in locality order.
+void route_in_order(Router &router, unsigned int algorithm, Trip_Batch &batch, const Locality_Key *locality, string &out)
+{
+  vector<Plan> plans;
+  route_batch(router, algorithm, batch, locality, plans);
+  for (size_t i = 0; i < batch.trips.size(); ++i)
+    write_plan(out, batch.trips[i], plans[batch.copy_of[i]]);
+}
 
-    trip_list.pop_back();
-    //read_out.close();
-  }
-  /* while (!request_handler.finished())
+/// Worker: route all ranges taken from the pool.
+/// Unordered, ranges are ranges of bundles and plans are collected in a
+/// buffer handed to the writer when full.  Ordered, ranges are ranges of
+/// input trips, deduplicated and bundled on their own, and each range is
+/// handed to the writer as one chunk in input order.
+void worker_method(unsigned int worker, Work_Pool &pool, const Trip_Batch &batch, Routing_Context &context, unsigned int algorithm, const Locality_Key *locality, Plan_Writer &writer, Plan_Cache *plan_cache, const Search_Budget &budget, bool keep_order)
+{
+  const size_t flush_bytes = 1 << 20;
+  Router router(context);
+  router.set_cache(plan_cache);
+  router.set_budget(budget);
+
+  Work_Range range;
+  vector<Trip_Request> bundle_trips;
+  vector<Plan> bundle_plans;
+  string buffer;
+  vector<size_t> batches;
+  while (pool.next(worker, range))
   {
-    Trip_Request trip_request = request_handler.request();
+    if (keep_order)
+    {
+      Trip_Batch local;
+      local.trips.assign(batch.trips.begin() + range.begin, batch.trips.begin() + range.end);
+      route_in_order(router, algorithm, local, locality, buffer);
+
+      Output_Chunk *chunk = writer.new_chunk();
+      chunk->sequence = range.index;
+      chunk->text.swap(buffer);
+      chunk->batches.assign(1, range.index);
+      writer.submit(chunk);
+      continue;
+    }
 
-    float distance = 0.0;
+    for (size_t b = range.begin; b < range.end; ++b)
+    {
+      route_bundle(router, algorithm, batch, b, bundle_trips, bundle_plans);
+      for (size_t i = 0; i < bundle_trips.size(); ++i)
+      {
+        const vector<size_t> &copy_list = batch.copies[batch.bundles[b][i]];
+        for (size_t c = 0; c < copy_list.size(); ++c)
+          write_plan(buffer, batch.trips[copy_list[c]], bundle_plans[i]);
+      }
+    }
+    batches.push_back(range.index);
+    if (buffer.size() >= flush_bytes)
+    {
+      Output_Chunk *chunk = writer.new_chunk();
+      chunk->text.swap(buffer);
+      chunk->batches.swap(batches);
+      writer.submit(chunk);
+    }
+  }
 
-    plan.path.clear();
-    event_handler.clear();
-    double time_elapsed;
+  if (!batches.empty())
+  {
+    Output_Chunk *chunk = writer.new_chunk();
+    chunk->text.swap(buffer);
+    chunk->batches.swap(batches);
+    writer.submit(chunk);
+  }
+}
 
-    router.find_path((Algorithm)algorithm, request_handler.request(), plan,
-                     time_elapsed, trip_request.nfaID);
+/// Chunk of consecutive input trips.
+struct Trip_Chunk
+{
+  /// Position of chunk in input.
+  size_t sequence;
 
-             << trip_request.source << '\t'
-             << trip_request.destination << '\t';
+  /// Trips of chunk.
+  Trip_Batch batch;
+};
 
-    out_file << plan << endl;
+/// Pipeline parser stage: stream trips of the request files to the workers in chunks.
+/// Stops at the first malformed line, leaving its message in parse_error.
+void parser_method(const vector<string_pair> &requestName, const Network_Graph &network, size_t nmb_nfas, const Shard &shard, size_t batch_trips, Bounded_Queue<Trip_Chunk *> &trip_queue, atomic<bool> &parsed, string &parse_error)
+{
+  Back_Off back_off;
+  size_t sequence = 0;
+  size_t position = 0;
+  Trip_Loader loader(network, 1, nmb_nfas);
+  Trip_Chunk *chunk = new Trip_Chunk;
+  for (size_t f = 0; f < requestName.size() && parse_error.empty(); ++f)
+  {
+    Trip_Reader reader(loader);
+    Trip_Request trip;
+    if (reader.open(requestName[f].first.c_str()))
+      while (reader.next(trip))
+      {
+        if (shard.contains(trip, position++))
+          chunk->batch.trips.push_back(trip);
+        if (chunk->batch.trips.size() == batch_trips)
+        {
+          chunk->sequence = sequence++;
+          back_off.reset();
+          while (!trip_queue.try_push(chunk))
+            back_off.wait();
+          chunk = new Trip_Chunk;
+        }
+      }
+    parse_error = reader.error();
+  }
 
-    bool error = false;
-    string error_message = "Differing distances:  request " + itos(trip_request.source) + "--" + itos(trip_request.destination) + "  distances";
+  if (chunk->batch.trips.empty())
+    delete chunk;
+  else
+  {
+    chunk->sequence = sequence++;
+    while (!trip_queue.try_push(chunk))
+      back_off.wait();
+  }
+  parsed.store(true, memory_order_release);
+}
 
-    error_message += " " + ftos(distance);
-    error_message += "  differences";
+/// Pipeline routing stage: route chunks from the parser and hand their plans to the writer.
+void pipeline_worker_method(Bounded_Queue<Trip_Chunk *> &trip_queue, atomic<bool> &parsed, Routing_Context &context, unsigned int algorithm, const Locality_Key *locality, Plan_Writer &writer, Plan_Cache *plan_cache, const Search_Budget &budget, bool keep_order)
+{
+  const size_t flush_bytes = 1 << 20;
+  Router router(context);
+  router.set_cache(plan_cache);
+  router.set_budget(budget);
+
+  Back_Off back_off;
+  Trip_Chunk *chunk;
+  vector<Trip_Request> bundle_trips;
+  vector<Plan> bundle_plans;
+  string buffer;
+  for (;;)
+  {
+    if (!trip_queue.try_pop(chunk))
+    {
+      if (!parsed.load(memory_order_acquire))
+      {
+        back_off.wait();
+        continue;
+      }
+      if (!trip_queue.try_pop(chunk))
+        break;
+    }
+    back_off.reset();
 
-    if (error)
-      LOG4CPLUS_ERROR(main_logger, error_message);
+    route_in_order(router, algorithm, chunk->batch, locality, buffer);
+    if (keep_order || buffer.size() >= flush_bytes)
+    {
+      Output_Chunk *output = writer.new_chunk();
+      output->sequence = chunk->sequence;
+      output->text.swap(buffer);
+      writer.submit(output);
+    }
+    delete chunk;
+  }
 
-    request_handler.next_request();
-  }*/
+  if (!buffer.empty())
+  {
+    Output_Chunk *output = writer.new_chunk();
+    output->text.swap(buffer);
+    writer.submit(output);
+  }
 }
 
 int main(int argc, char *argv[])
@@ -225,26 +454,64 @@ int main(int argc, char *argv[])
   // parse command-line arguments
   int c;
   int core_num = 0;
-  Trip_Request request;
-  request.start_time = 0;
   Request_Handler request_handler;
   //Plan plan;
   ifstream pairs_file;
-  ofstream out_file;
+  Output_File out_file;
+  Link_Sequence_File link_file;
+  bool link_sequences = false;
+  bool async_output = false;
+  const char *checkpoint_filename = NULL;
+  double checkpoint_interval = 60;
   unsigned int algorithm = STD;
 
   unsigned singleNFA = 1;
-
-  cout << "*** Standard Dijkstra" << endl;
-  event_handler.set_filename_affix("D");
-  algorithm = STD;
+  double cache_megabytes = 0;
+  float cache_quantum = 900;
+  bool keep_order = false;
+  size_t batch_trips = 64;
+  bool pipeline = false;
+  bool pin_workers = false;
+  bool sort_locality = false;
+  Shard shard;
+  const struct option long_options[] = {
+    {"shard", required_argument, NULL, 'S'},
+    {"shard-by", required_argument, NULL, 'B'},
+    {"serve", required_argument, NULL, 'V'},
+    {"max-time", required_argument, NULL, 'T'},
+    {"max-settled", required_argument, NULL, 'E'},
+    {"max-seconds", required_argument, NULL, 'W'},
+    {"binary", no_argument, NULL, 'Y'},
+    {"link-sequences", no_argument, NULL, 'X'},
+    {"io-uring", no_argument, NULL, 'U'},
+    {"time-quantum", required_argument, NULL, 'Q'},
+    {"checkpoint", required_argument, NULL, 'K'},
+    {"checkpoint-interval", required_argument, NULL, 'I'},
+    {NULL, 0, NULL, 0}};
+  bool replicate = false;
+  const char *socket_path = NULL;
+  Search_Budget budget;
 
   //cleaned up parsing
-  while ((c = getopt(argc, argv, "a:c:d:f:g:ilnN:o:p:r:s:t:v:z")) != -1)
+  while ((c = getopt_long(argc, argv, "a:Ab:c:d:f:F:g:ikLm:nN:o:p:Pq:r:Rs:v:z", long_options, NULL)) != -1)
   {
 
     switch (c)
     {
+    case 'a':
+      algorithm = atoi(optarg);
+      if (algorithm > GOBI)
+      {
+        cout << "Invalid algorithm specified. Bye!" << endl;
+        exit(-1);
+      }
+      break;
+    case 'A':
+      pin_workers = true;
+      break;
+    case 'b':
+      batch_trips = max(atoi(optarg), 1);
+      break;
     case 'c':
       coords_filename = optarg;
       break;
@@ -260,18 +527,93 @@ int main(int argc, char *argv[])
       nfa_collection_filename = optarg;
       singleNFA = 0;
       break;
+    case 'k':
+      keep_order = true;
+      break;
+    case 'L':
+      sort_locality = true;
+      break;
+    case 'm':
+      cache_megabytes = atof(optarg);
+      break;
+    case 'o':
+      out_filename = optarg;
+      break;
+    case 'P':
+      pipeline = true;
+      break;
+    case 'q':
+      cache_quantum = atof(optarg);
+      break;
+    case 'R':
+      replicate = true;
+      break;
     case 's':
       core_num = atoi(optarg);
-    case 't':
-      request.start_time = atoi(optarg);
-      request_handler.set_mode(SINGLE);
       break;
     case 'F':
       request_input_output_file = optarg;
       break;
+    case 'S':
+      if (sscanf(optarg, "%u/%u", &shard.index, &shard.count) != 2 || shard.count == 0 || shard.index >= shard.count)
+      {
+        cout << "Invalid shard " << optarg << ", expected i/N with 0 <= i < N. Bye!" << endl;
+        exit(-1);
+      }
+      break;
+    case 'B':
+      if (string(optarg) != "hash" && string(optarg) != "range")
+      {
+        cout << "Invalid shard partition " << optarg << ", expected hash or range. Bye!" << endl;
+        exit(-1);
+      }
+      shard.by_range = string(optarg) == "range";
+      break;
+    case 'V':
+      socket_path = optarg;
+      break;
+    case 'T':
+      budget.max_travel_time = atof(optarg);
+      break;
+    case 'E':
+      budget.max_settled = strtoul(optarg, NULL, 10);
+      break;
+    case 'W':
+      budget.max_seconds = atof(optarg);
+      break;
+    case 'Y':
+      binary_plans = true;
+      break;
+    case 'X':
+      link_sequences = true;
+      break;
+    case 'U':
+      async_output = true;
+      break;
+    case 'K':
+      checkpoint_filename = optarg;
+      break;
+    case 'I':
+      checkpoint_interval = atof(optarg);
+      break;
+    case 'Q':
+      plan_time_quantum = atof(optarg);
+      if (!(plan_time_quantum > 0))
+      {
+        cout << "Invalid time quantum " << optarg << ". Bye!" << endl;
+        exit(-1);
+      }
+      break;
     }
   }
 
+  const char *algorithm_names[] = {"Standard Dijkstra", "Goal-directed Dijkstra",
+                                   "Bidirectional Dijkstra",
+                                   "Bidirectional, goal-directed Dijkstra"};
+  const char *algorithm_affixes[] = {"D", "G", "B", "C"};
+  cout << "*** " << algorithm_names[algorithm] << endl;
+  event_handler.set_filename_affix(algorithm_affixes[algorithm]);
+
   // control output
   cout << "Data:" << endl
        << " network: " << network_filename << endl
@@ -279,6 +621,13 @@ int main(int argc, char *argv[])
        << " NFA:     " << nfa_filename << endl
        << " NFAColl: " << nfa_collection_filename << endl;
 
+  // with replicas, node 0 uses the network built here; pin to its CPUs so
+  // that its pages are allocated there (first touch)
+  Worker_Placement placement;
+  pin_workers = pin_workers || replicate;
+  if (replicate)
+    pin_thread(placement.node(0).cpus);
+
   // build network
   LOG4CPLUS_DEBUG(main_logger, "Building network...");
   Network_Graph network(network_filename, coords_filename);
@@ -286,36 +635,231 @@ int main(int argc, char *argv[])
   LOG4CPLUS_DEBUG(main_logger, "Building NFA...");
   event_handler.set_graph(network);
 
-  //TODO CHANGE THIS
+  std::vector<string_pair> requestName;
+  if (*request_input_output_file)
+  {
+    if (ReadRouteRequestPairs(request_input_output_file, requestName) != 0)
+      exit(-1);
+  }
+  else
+    requestName.push_back(string_pair(pairs_filename, out_filename));
 
-  //Most if not all the changes should be coming from here
-  //splitting everything up into threads
-  //vector<vector<Trip_Request> > big_list = request_handler.thread_request(core_num);
-  vector<std::thread> threads;
+  // a checkpoint belongs to one run: same inputs and options that change plans
+  Checkpoint *checkpoint = NULL;
+  if (checkpoint_filename)
+  {
+    if (socket_path || pipeline || link_sequences || Output_File::compressed_name(out_filename))
+    {
+      cout << "Sorry, checkpoints need batch routing (no --serve or -P) into an uncompressed plan file. Bye!" << endl;
+      exit(-1);
+    }
+    string run = itos(network_fingerprint(network)) + " " + file_stamp(*nfa_collection_filename ? nfa_collection_filename : nfa_filename);
+    for (size_t f = 0; f < requestName.size(); ++f)
+      run += " " + file_stamp(requestName[f].first);
+    run += " " + itos(algorithm) + " " + itos(keep_order) + " " + itos(sort_locality) + " " + itos(batch_trips)
+      + " " + itos(shard.index) + "/" + itos(shard.count) + " " + itos(shard.by_range)
+      + " " + itos(binary_plans) + " " + ftos(plan_time_quantum)
+      + " " + ftos(cache_megabytes > 0 ? cache_quantum : 0)
+      + " " + ftos(budget.max_travel_time) + " " + itos(budget.max_settled);
+    checkpoint = new Checkpoint(checkpoint_filename, out_filename, run);
+    if (!checkpoint->load())
+    {
+      cout << "Sorry, " << checkpoint->error() << " Bye!" << endl;
+      exit(-1);
+    }
+  }
 
-  /*out_file.open(out_filename);
-  if (!out_file)
+  if (!socket_path && !Output_File::supported(out_filename))
+  {
+    cout << "Sorry, this router was built without Zstandard support (make ZSTD=1). Bye!" << endl;
+    exit(-1);
+  }
+  if (link_sequences && !socket_path)
+  {
+    // edge IDs are positions of links in the network file, listed once
+    link_network = &network;
+    link_file.open(out_filename);
+    string map_filename = string(out_filename) + ".edges";
+    if (!write_edge_map(map_filename.c_str(), network))
+    {
+      cout << "Sorry, could not write file " << map_filename << ". Bye!" << endl;
+      exit(-1);
+    }
+  }
+  else if (!socket_path)
+  {
+    out_file.open(out_filename, async_output, checkpoint && checkpoint->resumed() ? (off_t)checkpoint->output_offset() : -1);
+    if (async_output && out_file && !out_file.uring())
+      LOG4CPLUS_WARN(main_logger, "io_uring is unavailable, writing plans with pwrite.");
+  }
+  if (!socket_path && (link_network ? !link_file : !out_file))
   {
     cout << "Sorry, could not open file " << out_filename << ". Bye!" << endl;
     exit(-1);
-  }*/
-  std::vector<string_pair> requestName;
-  ReadRouteRequestPairs(request_input_output_file, requestName);
-  //TODO split the vectors
-  
+  }
+  if (!socket_path && !link_network && binary_plans && !(checkpoint && checkpoint->resumed()))
+    write_plan_header(out_file, plan_time_quantum);
+  Plan_Cache *plan_cache = NULL;
+  if (cache_megabytes > 0)
+    plan_cache = new Plan_Cache((size_t)(cache_megabytes * 1024 * 1024), cache_quantum);
+
+  // NFAs, their union and heuristic data are shared by all workers
+  vector<NFA_Graph *> nfaVector;
+  load_nfas(network, singleNFA, nfa_filename, nfa_collection_filename, nfaVector);
+
+  if (shard.by_range && pipeline)
+    shard.nmb_trips = count_trips(requestName, network, nfaVector.size());
+  if (shard.count > 1)
+    LOG4CPLUS_INFO(main_logger, "Routing shard " + itos(shard.index) + " of " + itos(shard.count) + (shard.by_range ? " (by range)." : " (by trip ID hash)."));
+  LOG4CPLUS_DEBUG(main_logger, "Building routing context...");
+  Routing_Context context(network, nfaVector, algorithm == BI || algorithm == GOBI);
+  LOG4CPLUS_DEBUG(main_logger, "Routing context built.");
+
+  // one replica of network and context per NUMA node, built on that node
+  vector<Routing_Context *> contexts(1, &context);
+  if (replicate && placement.size() > 1)
+  {
+    contexts.resize(placement.size());
+    vector<std::thread> builders;
+    for (unsigned int n = 1; n < placement.size(); ++n)
+      builders.push_back(std::thread([&, n]() {
+        pin_thread(placement.node(n).cpus);
+        Network_Graph *replica = new Network_Graph(network_filename, coords_filename);
+        vector<NFA_Graph *> replica_nfas;
+        load_nfas(*replica, singleNFA, nfa_filename, nfa_collection_filename, replica_nfas);
+        contexts[n] = new Routing_Context(*replica, replica_nfas, algorithm == BI || algorithm == GOBI);
+      }));
+    for (auto &builder : builders)
+      builder.join();
+    LOG4CPLUS_INFO(main_logger, "Built " + itos(placement.size()) + " replicas of the routing context.");
+  }
+  if (replicate)
+  {
+    // parser and writer threads inherit the main thread's CPUs
+    vector<int> all_cpus;
+    for (unsigned int n = 0; n < placement.size(); ++n)
+      all_cpus.insert(all_cpus.end(), placement.node(n).cpus.begin(), placement.node(n).cpus.end());
+    pin_thread(all_cpus);
+  }
+
+  // bundles are routed in space-filling-curve order of their trips
+  Locality_Key locality_key(network);
+  const Locality_Key *locality = sort_locality ? &locality_key : NULL;
+
+  unsigned int nmb_workers = core_num > 0 ? core_num : std::thread::hardware_concurrency();
+  if (nmb_workers == 0)
+    nmb_workers = 1;
+  Plan_Writer writer(link_network ? (ostream &)link_file : out_file, keep_order, 8 * nmb_workers);
+  vector<std::thread> threads;
 
-  //arbitrary 4 put in as top value, will change that later
-  for (int i = 0; i < 4; i++)
+  if (socket_path)
   {
-    threads.push_back(std::thread(thread_method, pairs_filename, requestName[i], std::ref(network), algorithm, std::ref(out_file), singleNFA, nfa_filename, nfa_collection_filename));
+    // daemon: workers and routers stay resident for all requests
+    Route_Server server(contexts, placement, pin_workers, nmb_workers, algorithm, locality, plan_cache, budget, batch_trips);
+    if (!server.listen(socket_path))
+    {
+      cout << "Sorry, could not listen on socket " << socket_path << " (" << strerror(errno) << "). Bye!" << endl;
+      exit(-1);
+    }
+    LOG4CPLUS_INFO(main_logger, "Serving on " + string(socket_path) + " with " + itos(nmb_workers) + " workers.");
+    server.run();
+    LOG4CPLUS_INFO(main_logger, "Server shut down.");
+    writer.close();
+  }
+  else if (pipeline)
+  {
+    // parser -> routing workers -> writer, each stage fed by a bounded queue
+    LOG4CPLUS_INFO(main_logger, "Streaming trips in chunks of " + itos(batch_trips) + " through " + itos(nmb_workers) + " workers.");
+    Bounded_Queue<Trip_Chunk *> trip_queue(4 * nmb_workers);
+    atomic<bool> parsed(false);
+    string parse_error;
+    std::thread parser(parser_method, std::cref(requestName), std::cref(network), nfaVector.size(), std::cref(shard), batch_trips, std::ref(trip_queue), std::ref(parsed), std::ref(parse_error));
+    for (unsigned int w = 0; w < nmb_workers; w++)
+      threads.push_back(std::thread([&, w]() {
+        if (pin_workers)
+          pin_thread(vector<int>(1, placement.cpu_of(w)));
+        pipeline_worker_method(trip_queue, parsed, *contexts[placement.node_of(w) % contexts.size()], algorithm, locality, writer, plan_cache, budget, keep_order);
+      }));
+
+    parser.join();
+    for (auto &entry : threads)
+      entry.join();
+    writer.close();
+    if (!parse_error.empty())
+    {
+      cout << "Sorry, " << parse_error << " Plans were written for the trips read before. Bye!" << endl;
+      exit(-1);
+    }
+  }
+  else
+  {
+    Trip_Batch batch;
+    read_trips(requestName, network, nfaVector.size(), nmb_workers, shard, batch);
+    if (!keep_order)
+    {
+      prepare_trips(batch);
+      if (batch.distinct.size() < batch.trips.size())
+        LOG4CPLUS_INFO(main_logger, itos(batch.trips.size() - batch.distinct.size()) + " of " + itos(batch.trips.size()) + " trips are duplicates.");
+      if (locality)
+        sort_by_locality(batch.distinct, *locality, batch.bundles);
+    }
+
+    // workers take small ranges of bundles and steal from each other when idle
+    vector<size_t> boundaries;
+    if (keep_order)
+      split_trips(batch, batch_trips, boundaries);
+    else
+      split_bundles(batch, batch_trips, boundaries);
+    Work_Pool pool(nmb_workers);
+    if (checkpoint)
+    {
+      out_file.flush();
+      if (!checkpoint->start(boundaries.size() - 1, keep_order))
+      {
+        cout << "Sorry, " << checkpoint->error() << " Bye!" << endl;
+        exit(-1);
+      }
+      if (checkpoint->resumed())
+        LOG4CPLUS_INFO(main_logger, "Resuming: " + itos(checkpoint->nmb_done()) + " of " + itos(boundaries.size() - 1) + " batches done, appending after byte " + itos(checkpoint->output_offset()) + ".");
+      writer.set_checkpoint(checkpoint, checkpoint_interval);
+      pool.distribute(boundaries, keep_order, checkpoint->done());
+    }
+    else
+      pool.distribute(boundaries, keep_order);
+    LOG4CPLUS_INFO(main_logger, "Routing " + itos(batch.trips.size()) + " trips in " + itos(boundaries.size() - 1) + " batches on " + itos(nmb_workers) + " workers.");
+
+    for (unsigned int w = 0; w < nmb_workers; w++)
+    {
+      threads.push_back(std::thread([&, w]() {
+        if (pin_workers)
+          pin_thread(vector<int>(1, placement.cpu_of(w)));
+        worker_method(w, pool, batch, *contexts[placement.node_of(w) % contexts.size()], algorithm, locality, writer, plan_cache, budget, keep_order);
+      }));
+    }
+
+    for (auto &entry : threads)
+    {
+      entry.join();
+    }
+    writer.close();
+    LOG4CPLUS_INFO(main_logger, itos(pool.steals()) + " batches stolen.");
   }
 
-  for (auto &entry : threads)
+  bool written = socket_path || (link_network ? link_file.close() : out_file.close());
+  if (!written)
+    LOG4CPLUS_ERROR(main_logger, "Could not write all plans to " + string(out_filename) + ".");
+  else if (checkpoint)
+    checkpoint->remove();
+  delete checkpoint;
+  for (unsigned int n = 1; n < contexts.size(); ++n)
   {
-    entry.join();
+    Network_Graph *replica = &contexts[n]->network();
+    delete contexts[n];
+    delete replica;
   }
 
-  out_file.close();
+  if (plan_cache)
+    LOG4CPLUS_INFO(main_logger, plan_cache->statistics());
 
-  return 0;
+  return written ? 0 : -1;
 }
\ No newline at end of file
@@ -0,0 +1,323 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef NFA_BUNDLE_HPP
+#define NFA_BUNDLE_HPP
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Binary bundle of the (pruned) NFAs of a collection.
+/// Header: magic "RRNFAS" + 0 + format version byte, number of NFAs n
+/// (u32), largest label (u32), words per label bitmask w (u32), padding
+/// (u32), total number of states s (u64) and transitions e (u64).  Then,
+/// little-endian and naturally aligned:
+///
+///   u64  first_state[n + 1]  states of NFA i: first_state[i]..first_state[i+1]
+///   u64  first_edge[s + 1]   transitions of state j, sorted by label
+///   u64  label_masks[s * w]  labels of the transitions of each state
+///   u32  heads[e]            head state, numbered within its NFA
+///   u32  labels[e]
+///   u8   flags[s]            1: start state, 2: accepting state
+///
+/// NFAs keep the order of the collection, as do their NFA IDs.
+const char NFA_BUNDLE_MAGIC[8] = { 'R', 'R', 'N', 'F', 'A', 'S', 0, 1 };
+
+
+/// Header of an NFA bundle.
+struct NFA_Bundle_Header
+{
+  char magic[8];
+  uint32_t nmb_nfas;
+  uint32_t max_label;
+  uint32_t label_words;
+  uint32_t padding;
+  uint64_t nmb_states;
+  uint64_t nmb_edges;
+};
+
+
+/// State flags of an NFA bundle.
+enum { NFA_BUNDLE_START = 1, NFA_BUNDLE_ACCEPTING = 2 };
+
+
+/// Get size of an NFA bundle.
+size_t nfa_bundle_size(const NFA_Bundle_Header& header)
+{
+  return sizeof(NFA_Bundle_Header) + (header.nmb_nfas + 1) * 8
+    + (header.nmb_states + 1) * 8 + header.nmb_states * header.label_words * 8
+    + header.nmb_edges * (4 + 4) + header.nmb_states;
+}
+
+
+/// Is file an NFA bundle?
+bool is_nfa_bundle(const char* filename)
+{
+  char magic[8];
+  ifstream file(filename, ios::binary);
+  return file.read(magic, 8) && memcmp(magic, NFA_BUNDLE_MAGIC, 8) == 0;
+}
+
+
+/// Read entries (NFA files or re:<expression>) of an NFA collection
+/// file: a comment line, the number of entries, one entry per line.
+/// Returns false if the file cannot be opened.
+bool read_nfa_collection(const char* filename, vector<string>& entries)
+{
+  ifstream file(filename);
+  if (!file)
+    return false;
+
+  char buffer[5000];
+  file.getline(buffer, 5000, '\n');
+
+  int nNFAs;
+
+  file >> nNFAs;
+  file.get();
+
+  for (unsigned int i = 0; (int)i < nNFAs; ++i)
+  {
+    file.getline(buffer, 5000, '\n');
+    entries.push_back(buffer);
+  }
+  return true;
+}
+
+
+/// Write NFAs as NFA bundle; false on error.
+bool write_nfa_bundle(const char* filename, const vector<NFA_Graph*>& nfas)
+{
+  NFA_Bundle_Header header;
+  memcpy(header.magic, NFA_BUNDLE_MAGIC, 8);
+  header.nmb_nfas = nfas.size();
+  header.max_label = 0;
+  header.padding = 0;
+
+  vector<uint64_t> first_state(1, 0), first_edge(1, 0);
+  vector<uint32_t> heads, labels;
+  vector<uint8_t> flags;
+  for (size_t i = 0; i < nfas.size(); ++i)
+  {
+    for (NFA_Graph::const_iterator vertex_it = nfas[i]->begin();
+	 vertex_it != nfas[i]->end(); vertex_it++)
+    {
+      for (NFA_Vertex::Edge_It edge_it = (*vertex_it)->out_edge_begin();
+	   edge_it != (*vertex_it)->out_edge_end(); edge_it++)
+      {
+	heads.push_back((*edge_it)->head()->id());
+	labels.push_back((*edge_it)->label());
+	header.max_label = max(header.max_label, labels.back());
+      }
+      first_edge.push_back(heads.size());
+      flags.push_back(((*vertex_it)->start() ? NFA_BUNDLE_START : 0) |
+		      ((*vertex_it)->accepting() ? NFA_BUNDLE_ACCEPTING : 0));
+    }
+    first_state.push_back(flags.size());
+  }
+  header.nmb_states = flags.size();
+  header.nmb_edges = heads.size();
+  header.label_words = (header.max_label + 64) / 64;
+
+  vector<uint64_t> label_masks(header.nmb_states * header.label_words, 0);
+  for (size_t state = 0; state < header.nmb_states; ++state)
+    for (uint64_t e = first_edge[state]; e < first_edge[state + 1]; ++e)
+      label_masks[state * header.label_words + labels[e] / 64] |= (uint64_t)1 << (labels[e] % 64);
+
+  ofstream out(filename, ios::binary);
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)first_state.data(), first_state.size() * 8);
+  out.write((const char*)first_edge.data(), first_edge.size() * 8);
+  out.write((const char*)label_masks.data(), label_masks.size() * 8);
+  out.write((const char*)heads.data(), heads.size() * 4);
+  out.write((const char*)labels.data(), labels.size() * 4);
+  out.write((const char*)flags.data(), flags.size());
+  out.close();
+  return !out.fail();
+}
+
+
+
+/// Mapped NFA bundle.  The file is mapped once; the NFAs built from it
+/// (for any number of network replicas) use its label bitmasks, so the
+/// bundle has to outlive them.
+class NFA_Bundle
+{
+protected:
+  /// Mapping.
+  void* mapping;
+
+  /// Size of mapping.
+  size_t size;
+
+  /// Header.
+  NFA_Bundle_Header header;
+
+  /// Columns.
+  const uint64_t* first_state;
+  const uint64_t* first_edge;
+  const uint64_t* label_masks;
+  const uint32_t* heads;
+  const uint32_t* labels;
+  const uint8_t* flags;
+
+  /// Message of the last error.
+  string error_message;
+
+  /// Check columns, including the label bitmasks; false with error
+  /// message if the file is damaged.
+  bool check(const char* filename);
+
+
+public:
+  /// Constructor.
+  NFA_Bundle(): mapping(NULL), size(0), header(), first_state(NULL),
+    first_edge(NULL), label_masks(NULL), heads(NULL), labels(NULL),
+    flags(NULL), error_message() {}
+
+  /// Destructor.
+  ~NFA_Bundle()
+  {
+    if (mapping)
+      munmap(mapping, size);
+  }
+
+  /// Map file; false with error message on error.
+  bool open(const char* filename);
+
+  /// Is a bundle mapped?
+  bool is_open() const { return mapping != NULL; }
+
+  /// Get number of NFAs.
+  unsigned int nmb_nfas() const { return header.nmb_nfas; }
+
+  /// Build NFA i; the caller owns it.
+  NFA_Graph* nfa(unsigned int i) const;
+
+  /// Get message of the last error.
+  const string& error() const { return error_message; }
+};
+
+
+bool NFA_Bundle::open(const char* filename)
+{
+  int fd = ::open(filename, O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0)
+  {
+    if (fd >= 0)
+      close(fd);
+    error_message = "could not open the NFA bundle " + string(filename) + ".";
+    return false;
+  }
+  size = status.st_size;
+  mapping = size >= sizeof(header) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    mapping = NULL;
+    error_message = "could not map the NFA bundle " + string(filename) + ".";
+    return false;
+  }
+  const char* data = (const char*)mapping;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, NFA_BUNDLE_MAGIC, 8) != 0)
+  {
+    error_message = string(filename) + " is no NFA bundle.";
+    return false;
+  }
+  if (header.nmb_nfas > size || header.nmb_states > size || header.nmb_edges > size ||
+      header.label_words != (header.max_label + 64) / 64 ||
+      size != nfa_bundle_size(header))
+  {
+    error_message = "the NFA bundle " + string(filename) + " is damaged.";
+    return false;
+  }
+  first_state = (const uint64_t*)(data + sizeof(header));
+  first_edge = first_state + header.nmb_nfas + 1;
+  label_masks = first_edge + header.nmb_states + 1;
+  heads = (const uint32_t*)(label_masks + header.nmb_states * header.label_words);
+  labels = heads + header.nmb_edges;
+  flags = (const uint8_t*)(labels + header.nmb_edges);
+  return check(filename);
+}
+
+
+bool NFA_Bundle::check(const char* filename)
+{
+  bool ok = first_state[0] == 0 && first_state[header.nmb_nfas] == header.nmb_states
+    && first_edge[0] == 0 && first_edge[header.nmb_states] == header.nmb_edges;
+  // label bitmasks are rebuilt from the transitions, as next_label relies
+  // on them to skip labels
+  vector<uint64_t> mask(header.label_words);
+  for (unsigned int i = 0; ok && i < header.nmb_nfas; ++i)
+  {
+    ok = first_state[i] <= first_state[i + 1] && first_state[i + 1] <= header.nmb_states;
+    for (uint64_t state = first_state[i]; ok && state < first_state[i + 1]; ++state)
+    {
+      ok = first_edge[state] <= first_edge[state + 1] && first_edge[state + 1] <= header.nmb_edges;
+      fill(mask.begin(), mask.end(), 0);
+      for (uint64_t e = first_edge[state]; ok && e < first_edge[state + 1]; ++e)
+      {
+	ok = heads[e] < first_state[i + 1] - first_state[i] && labels[e] <= header.max_label
+	  && (e == first_edge[state] || labels[e - 1] <= labels[e]);
+	if (ok)
+	  mask[labels[e] / 64] |= (uint64_t)1 << (labels[e] % 64);
+      }
+      ok = ok && memcmp(mask.data(), label_masks + state * header.label_words,
+			header.label_words * 8) == 0;
+    }
+  }
+  if (!ok)
+    error_message = "the NFA bundle " + string(filename) + " is damaged.";
+  return ok;
+}
+
+
+NFA_Graph* NFA_Bundle::nfa(unsigned int i) const
+{
+  NFA_Graph* nfa = new NFA_Graph();
+  const uint64_t first = first_state[i];
+  for (uint64_t state = first; state < first_state[i + 1]; ++state)
+  {
+    bool is_start = flags[state] & NFA_BUNDLE_START;
+    bool is_accepting = flags[state] & NFA_BUNDLE_ACCEPTING;
+    NFA_Vertex* new_vertex = nfa->add_vertex(state - first, is_start, is_accepting);
+    new_vertex->set_label_mask(label_masks + state * header.label_words, header.label_words);
+    if (is_start)
+      nfa->add_start(new_vertex);
+    if (is_accepting)
+      nfa->add_accepting(new_vertex);
+  }
+  // transitions are sorted by label; added last to first, each one goes
+  // to the front of the edge list
+  for (uint64_t state = first; state < first_state[i + 1]; ++state)
+    for (uint64_t e = first_edge[state + 1]; e-- > first_edge[state]; )
+      nfa->add_edge((*nfa)[state - first], (*nfa)[heads[e]], labels[e]);
+  nfa->set_edge_pointers();
+  return nfa;
+}
+
+
+#endif
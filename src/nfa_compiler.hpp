@@ -0,0 +1,474 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef NFA_COMPILER_HPP
+#define NFA_COMPILER_HPP
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "basics.hpp"
+#include "graph.hpp"
+
+#include <log4cplus/logger.h>
+#include <log4cplus/loglevel.h>
+
+using namespace std;
+using namespace log4cplus;
+
+// ----------------------------------------------------------------------------
+
+
+/// Compiler from label regular expressions to automata.
+/// Syntax: a symbol is a letter (looked up in the symbol table) or a
+/// decimal label; expressions are built with concatenation, '|', '*', '+',
+/// '?' and parentheses.  Blanks are ignored, empty alternatives match the
+/// empty word.  Example: "w*(a)*w*".
+/// The expression is translated into an epsilon-automaton (Thompson),
+/// epsilons are removed or the automaton is determinised (subset
+/// construction), and the result is minimised with NFA_Graph::prune.
+/// Compiled automata are cached and shared; they must not be modified.
+/// Syntax errors are returned, not fatal, as the compiler also runs inside
+/// the routing library.  One compiler may be used by several threads; its
+/// compilations are serialised.
+/// The global MAX_LABEL is left alone: the labels of an automaton are
+/// given by NFA_Graph::max_label.
+class NFA_Compiler
+{
+protected:
+  /// Epsilon-automaton state.
+  struct Thompson_State
+  {
+    /// Labeled transitions.
+    vector<pair<Label, int> > transitions;
+
+    /// Epsilon transitions.
+    vector<int> epsilons;
+  };
+
+  /// Sub-automaton with one entry and one exit state.
+  struct Fragment
+  {
+    int start;
+    int accept;
+  };
+
+  /// Letter to label mapping.
+  map<char, Label> symbols;
+
+  /// Epsilon-automaton under construction.
+  vector<Thompson_State> states;
+
+  /// Expression being parsed.
+  string expression;
+
+  /// Parse position.
+  size_t pos;
+
+  /// Message of the first syntax error of the expression (empty if none).
+  string error_message;
+
+  /// Cache of compiled automata.
+  map<string, NFA_Graph*> cache;
+
+  /// Guards symbols, the parse state and the cache.
+  mutex compiler_mutex;
+
+  /// Logger.
+  Logger compiler_logger;
+
+
+  /// Add epsilon-automaton state.
+  int new_state()
+  {
+    states.push_back(Thompson_State());
+    return states.size() - 1;
+  }
+
+  /// Skip blanks.
+  void skip_blanks()
+  {
+    while (pos < expression.size() && isspace(expression[pos]))
+      ++pos;
+  }
+
+  /// Parse alternatives.
+  Fragment parse_alternative();
+
+  /// Parse concatenation.
+  Fragment parse_concatenation();
+
+  /// Parse repetitions.
+  Fragment parse_repetition();
+
+  /// Parse symbol or parenthesized expression.
+  Fragment parse_atom();
+
+  /// Record syntax error, unless there is one already, and stop parsing.
+  void syntax_error(const string& message);
+
+  /// Fragment matching the empty word.
+  Fragment empty_fragment()
+  {
+    int state = new_state();
+    Fragment fragment = { state, state };
+    return fragment;
+  }
+
+  /// Epsilon closure of a set of states.
+  set<int> closure(const set<int>& seed) const;
+
+  /// Build automaton without epsilons, one state per Thompson state.
+  void build_nfa(const Fragment& fragment, NFA_Graph& nfa);
+
+  /// Build deterministic automaton by subset construction.
+  void build_dfa(const Fragment& fragment, NFA_Graph& nfa);
+
+  /// Compile expression into a new automaton; NULL on a syntax error,
+  /// whose message goes to error if given.  The caller holds
+  /// compiler_mutex.
+  NFA_Graph* translate(const string& regex, bool determinise, bool minimise,
+		       string* error);
+
+
+public:
+  /// Constructor.
+  /// Default symbols follow the sample networks: a (auto) = 0, w (walk) = 3.
+  NFA_Compiler(): symbols(), states(), expression(), pos(0), error_message(), cache(),
+		  compiler_logger(Logger::getInstance("NFA_Compiler"))
+  {
+    compiler_logger.addAppender(myConsoleAppender);
+    compiler_logger.setLogLevel(INFO_LOG_LEVEL);
+    symbols['a'] = 0;
+    symbols['w'] = 3;
+  }
+
+  /// Set label of a letter.
+  void set_symbol(char letter, const Label& label)
+  {
+    lock_guard<mutex> lock(compiler_mutex);
+    symbols[letter] = label;
+  }
+
+  /// Compile expression into a new automaton; NULL on a syntax error,
+  /// whose message goes to error if given.
+  NFA_Graph* compile(const string& regex, bool determinise = true,
+		     bool minimise = true, string* error = NULL)
+  {
+    lock_guard<mutex> lock(compiler_mutex);
+    return translate(regex, determinise, minimise, error);
+  }
+
+  /// Compile expression, reusing a cached automaton if available; NULL on
+  /// a syntax error, whose message goes to error if given.
+  NFA_Graph* compiled(const string& regex, bool determinise = true,
+		      bool minimise = true, string* error = NULL);
+};
+
+
+void NFA_Compiler::syntax_error(const string& message)
+{
+  if (error_message.empty())
+    error_message = message + " at position " + itos(pos) + " in \"" + expression + "\".";
+  pos = expression.size();
+}
+
+
+NFA_Compiler::Fragment NFA_Compiler::parse_alternative()
+{
+  Fragment fragment = parse_concatenation();
+  skip_blanks();
+  while (pos < expression.size() && expression[pos] == '|')
+  {
+    ++pos;
+    Fragment other = parse_concatenation();
+    Fragment joined = { new_state(), new_state() };
+    states[joined.start].epsilons.push_back(fragment.start);
+    states[joined.start].epsilons.push_back(other.start);
+    states[fragment.accept].epsilons.push_back(joined.accept);
+    states[other.accept].epsilons.push_back(joined.accept);
+    fragment = joined;
+    skip_blanks();
+  }
+  return fragment;
+}
+
+
+NFA_Compiler::Fragment NFA_Compiler::parse_concatenation()
+{
+  int start = new_state();
+  Fragment fragment = { start, start };
+  skip_blanks();
+  while (pos < expression.size() && expression[pos] != '|'
+	 && expression[pos] != ')')
+  {
+    Fragment next = parse_repetition();
+    states[fragment.accept].epsilons.push_back(next.start);
+    fragment.accept = next.accept;
+    skip_blanks();
+  }
+  return fragment;
+}
+
+
+NFA_Compiler::Fragment NFA_Compiler::parse_repetition()
+{
+  Fragment fragment = parse_atom();
+  skip_blanks();
+  while (pos < expression.size() &&
+	 (expression[pos] == '*' || expression[pos] == '+'
+	  || expression[pos] == '?'))
+  {
+    char op = expression[pos++];
+    Fragment wrapped = { new_state(), new_state() };
+    states[wrapped.start].epsilons.push_back(fragment.start);
+    states[fragment.accept].epsilons.push_back(wrapped.accept);
+    if (op != '+')
+      states[wrapped.start].epsilons.push_back(wrapped.accept);
+    if (op != '?')
+      states[fragment.accept].epsilons.push_back(fragment.start);
+    fragment = wrapped;
+    skip_blanks();
+  }
+  return fragment;
+}
+
+
+NFA_Compiler::Fragment NFA_Compiler::parse_atom()
+{
+  skip_blanks();
+  if (pos >= expression.size())
+  {
+    syntax_error("unexpected end of expression");
+    return empty_fragment();
+  }
+
+  char c = expression[pos];
+  if (c == '(')
+  {
+    ++pos;
+    Fragment fragment = parse_alternative();
+    if (pos >= expression.size() || expression[pos] != ')')
+      syntax_error("missing ')'");
+    else
+      ++pos;
+    return fragment;
+  }
+
+  Label label;
+  if (isdigit(c))
+  {
+    label = 0;
+    while (pos < expression.size() && isdigit(expression[pos]))
+      label = 10 * label + (expression[pos++] - '0');
+  }
+  else if (symbols.find(c) != symbols.end())
+  {
+    label = symbols[c];
+    ++pos;
+  }
+  else
+  {
+    syntax_error(string("unknown symbol '") + c + "'");
+    return empty_fragment();
+  }
+
+  Fragment fragment = { new_state(), new_state() };
+  states[fragment.start].transitions.push_back(make_pair(label, fragment.accept));
+  return fragment;
+}
+
+
+set<int> NFA_Compiler::closure(const set<int>& seed) const
+{
+  set<int> result(seed);
+  vector<int> pending(seed.begin(), seed.end());
+  while (!pending.empty())
+  {
+    int state = pending.back();
+    pending.pop_back();
+    for (size_t i=0; i<states[state].epsilons.size(); ++i)
+      if (result.insert(states[state].epsilons[i]).second)
+	pending.push_back(states[state].epsilons[i]);
+  }
+  return result;
+}
+
+
+void NFA_Compiler::build_nfa(const Fragment& fragment, NFA_Graph& nfa)
+{
+  // renumber so that the start state comes first
+  vector<int> number(states.size());
+  for (size_t s=0; s<states.size(); ++s)
+    number[s] = s;
+  swap(number[0], number[fragment.start]);
+
+  vector<NFA_Vertex*> vertex(states.size());
+  vector<set<int> > closures(states.size());
+  for (size_t n=0; n<states.size(); ++n)
+  {
+    int s = number[n];
+    closures[s] = closure(set<int>(&s, &s + 1));
+    bool is_start = (s == fragment.start);
+    bool is_accepting = closures[s].count(fragment.accept) > 0;
+    vertex[s] = nfa.add_vertex(n, is_start, is_accepting);
+    if (is_start)
+      nfa.add_start(vertex[s]);
+    if (is_accepting)
+      nfa.add_accepting(vertex[s]);
+  }
+
+  for (size_t s=0; s<states.size(); ++s)
+  {
+    set<pair<Label, int> > transitions;
+    for (set<int>::const_iterator it=closures[s].begin();
+	 it!=closures[s].end(); ++it)
+      transitions.insert(states[*it].transitions.begin(),
+			 states[*it].transitions.end());
+    for (set<pair<Label, int> >::const_iterator it=transitions.begin();
+	 it!=transitions.end(); ++it)
+      nfa.add_edge(vertex[s], vertex[it->second], it->first);
+  }
+}
+
+
+void NFA_Compiler::build_dfa(const Fragment& fragment, NFA_Graph& nfa)
+{
+  map<set<int>, NFA_Vertex*> dfa_state;
+  vector<set<int> > pending;
+
+  set<int> start_set = closure(set<int>(&fragment.start, &fragment.start + 1));
+  NFA_Vertex* start_vertex =
+    nfa.add_vertex(0, true, start_set.count(fragment.accept) > 0);
+  nfa.add_start(start_vertex);
+  if (start_vertex->accepting())
+    nfa.add_accepting(start_vertex);
+  dfa_state[start_set] = start_vertex;
+  pending.push_back(start_set);
+
+  while (!pending.empty())
+  {
+    set<int> current = pending.back();
+    pending.pop_back();
+
+    map<Label, set<int> > successors;
+    for (set<int>::const_iterator it=current.begin(); it!=current.end(); ++it)
+      for (size_t i=0; i<states[*it].transitions.size(); ++i)
+	successors[states[*it].transitions[i].first].insert(states[*it].transitions[i].second);
+
+    for (map<Label, set<int> >::iterator it=successors.begin();
+	 it!=successors.end(); ++it)
+    {
+      set<int> target = closure(it->second);
+      map<set<int>, NFA_Vertex*>::iterator found = dfa_state.find(target);
+      if (found == dfa_state.end())
+      {
+	bool is_accepting = target.count(fragment.accept) > 0;
+	NFA_Vertex* new_vertex = nfa.add_vertex(nfa.size(), false, is_accepting);
+	if (is_accepting)
+	  nfa.add_accepting(new_vertex);
+	found = dfa_state.insert(make_pair(target, new_vertex)).first;
+	pending.push_back(target);
+      }
+      nfa.add_edge(dfa_state[current], found->second, it->first);
+    }
+  }
+}
+
+
+NFA_Graph* NFA_Compiler::translate(const string& regex, bool determinise,
+				   bool minimise, string* error)
+{
+  states.clear();
+  expression = regex;
+  pos = 0;
+  error_message.clear();
+  Fragment fragment = parse_alternative();
+  if (pos != expression.size())
+    syntax_error("unexpected ')'");
+  if (!error_message.empty())
+  {
+    LOG4CPLUS_DEBUG(compiler_logger, "NFA_Compiler: " + error_message);
+    if (error)
+      *error = error_message;
+    return NULL;
+  }
+
+  NFA_Graph* nfa = new NFA_Graph();
+  if (determinise)
+    build_dfa(fragment, *nfa);
+  else
+    build_nfa(fragment, *nfa);
+  nfa->set_edge_pointers();
+  if (minimise)
+    nfa->prune();
+  LOG4CPLUS_INFO(compiler_logger, "Compiled \"" + regex + "\" into "
+		 + itos(nfa->size()) + " states, largest label "
+		 + itos(nfa->max_label()) + ".");
+  return nfa;
+}
+
+
+NFA_Graph* NFA_Compiler::compiled(const string& regex, bool determinise,
+				  bool minimise, string* error)
+{
+  string key = regex + (determinise ? "/d" : "/n") + (minimise ? "m" : "");
+  lock_guard<mutex> lock(compiler_mutex);
+  map<string, NFA_Graph*>::iterator it = cache.find(key);
+  if (it == cache.end())
+  {
+    NFA_Graph* nfa = translate(regex, determinise, minimise, error);
+    if (nfa == NULL)
+      return NULL;
+    it = cache.insert(make_pair(key, nfa)).first;
+  }
+  return it->second;
+}
+
+
+/// Shared compiler instance.
+NFA_Compiler nfa_compiler;
+
+
+/// Get automaton for an entry of an NFA collection.
+/// Entries "re:<expression>" are compiled (cached, determinised and
+/// minimised); any other entry is the name of an NFA file.  The caller
+/// owns the returned automaton; compiled ones are copies of the cached one.
+/// Returns NULL with error message on a syntax error or a bad NFA file.
+NFA_Graph* load_nfa(const string& entry, Network_Graph& network, string& error)
+{
+  if (entry.compare(0, 3, "re:") == 0)
+  {
+    NFA_Graph* compiled = nfa_compiler.compiled(entry.substr(3), true, true, &error);
+    if (compiled == NULL)
+    {
+      error = "syntax error in the NFA expression: " + error;
+      return NULL;
+    }
+    NFA_Graph* nfa = new NFA_Graph();
+    nfa->add_disjoint(*compiled);
+    nfa->set_edge_pointers();
+    return nfa;
+  }
+  NFA_Graph* nfa = new NFA_Graph(entry, network);
+  if (!nfa->error().empty())
+  {
+    error = nfa->error();
+    delete nfa;
+    return NULL;
+  }
+  return nfa;
+}
+
+
+#endif
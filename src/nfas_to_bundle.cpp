@@ -0,0 +1,67 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  Convert an NFA collection into an NFA bundle: all NFAs of the
+  collection, pruned, with the label bitmasks of their states.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "graph.hpp"
+#include "nfa_bundle.hpp"
+#include "nfa_compiler.hpp"
+
+using namespace std;
+
+Event_Handler event_handler;
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    cout << "Usage: nfas_to_bundle <NFA collection> <NFA bundle>" << endl
+	 << " Loads the NFAs (files or re:<expression>) of an NFA collection"
+	 << " file and writes them as NFA bundle read by new_main -N." << endl;
+    return 0;
+  }
+
+  vector<string> entries;
+  if (!read_nfa_collection(argv[1], entries))
+  {
+    cout << "Sorry, could not open the NFA collection " << argv[1] << ". Bye!" << endl;
+    exit(-1);
+  }
+
+  // NFAs do not depend on the network
+  Network_Graph network;
+  vector<NFA_Graph*> nfas;
+  string error;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    nfas.push_back(load_nfa(entries[i], network, error));
+    if (nfas.back() == NULL)
+    {
+      cout << "Sorry, " << error << " Bye!" << endl;
+      exit(-1);
+    }
+  }
+
+  if (!write_nfa_bundle(argv[2], nfas))
+  {
+    cout << "Sorry, could not write file " << argv[2] << ". Bye!" << endl;
+    exit(-1);
+  }
+  cout << "Wrote " << nfas.size() << " NFAs." << endl;
+  for (size_t i = 0; i < nfas.size(); ++i)
+    delete nfas[i];
+  return 0;
+}
@@ -0,0 +1,148 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// NUMA node.
+struct Numa_Node
+{
+  /// Node number.
+  int id;
+
+  /// CPUs of node.
+  vector<int> cpus;
+};
+
+
+/// Parse a sysfs CPU list such as "0-3,8-11".
+vector<int> parse_cpu_list(const string& list)
+{
+  vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size())
+  {
+    size_t end = list.find(',', pos);
+    if (end == string::npos)
+      end = list.size();
+    string item = list.substr(pos, end - pos);
+    size_t dash = item.find('-');
+    if (!item.empty() && item[0] >= '0' && item[0] <= '9')
+    {
+      int first = atoi(item.c_str());
+      int last = dash == string::npos ? first : atoi(item.c_str() + dash + 1);
+      for (int cpu = first; cpu <= last; ++cpu)
+	cpus.push_back(cpu);
+    }
+    pos = end + 1;
+  }
+  return cpus;
+}
+
+
+/// Get NUMA nodes with their CPUs from sysfs.
+/// Without NUMA information a single node with all CPUs is returned.
+vector<Numa_Node> numa_topology()
+{
+  vector<Numa_Node> nodes;
+  const string root = "/sys/devices/system/node/";
+  DIR* dir = opendir(root.c_str());
+  if (dir)
+  {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+      string name = entry->d_name;
+      if (name.compare(0, 4, "node") != 0 || name.size() == 4
+	  || name[4] < '0' || name[4] > '9')
+	continue;
+      ifstream cpu_list((root + name + "/cpulist").c_str());
+      string list;
+      getline(cpu_list, list);
+      Numa_Node node;
+      node.id = atoi(name.c_str() + 4);
+      node.cpus = parse_cpu_list(list);
+      if (!node.cpus.empty())
+	nodes.push_back(node);
+    }
+    closedir(dir);
+  }
+
+  if (nodes.empty())
+  {
+    Numa_Node node;
+    node.id = 0;
+    for (int cpu = 0; cpu < (int)max(std::thread::hardware_concurrency(), 1u); ++cpu)
+      node.cpus.push_back(cpu);
+    nodes.push_back(node);
+  }
+  sort(nodes.begin(), nodes.end(),
+       [](const Numa_Node& a, const Numa_Node& b) { return a.id < b.id; });
+  return nodes;
+}
+
+
+/// Restrict calling thread to the given CPUs; false on failure.
+bool pin_thread(const vector<int>& cpus)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < cpus.size(); ++i)
+    CPU_SET(cpus[i], &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+
+/// Placement of worker threads on NUMA nodes.
+/// Workers are spread round-robin over the nodes and, within a node, over
+/// its CPUs, so n workers use n distinct cores as long as there are enough.
+class Worker_Placement
+{
+protected:
+  /// NUMA nodes.
+  vector<Numa_Node> nodes;
+
+public:
+  /// Constructor.
+  Worker_Placement(): nodes(numa_topology()) {}
+
+  /// Get number of nodes.
+  unsigned int size() const { return nodes.size(); }
+
+  /// Get node.
+  const Numa_Node& node(unsigned int i) const { return nodes[i]; }
+
+  /// Get node index of worker.
+  unsigned int node_of(unsigned int worker) const { return worker % nodes.size(); }
+
+  /// Get CPU of worker.
+  int cpu_of(unsigned int worker) const
+  {
+    const vector<int>& cpus = nodes[node_of(worker)].cpus;
+    return cpus[(worker / nodes.size()) % cpus.size()];
+  }
+};
+
+
+#endif
@@ -0,0 +1,322 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef OUTPUT_FILE_HPP
+#define OUTPUT_FILE_HPP
+
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "uring_file.hpp"
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Stream buffer compressing everything written to it into a file.
+/// Data is compressed by the thread writing to the stream, i.e. by the
+/// writer thread of Plan_Writer, and not by the routing workers.
+class Compressing_Buffer : public streambuf
+{
+protected:
+  /// Compressed file.
+  ofstream file;
+
+  /// Uncompressed data not yet compressed (put area).
+  vector<char> input;
+
+  /// Compressed data.
+  vector<char> output;
+
+  /// Has an error occurred?
+  bool failed;
+
+  /// Compress data, and finish the compressed stream if last; writes
+  /// compressed data to file and returns false on error.
+  virtual bool compress(const char* data, size_t size, bool last) = 0;
+
+  /// Compress the put area.
+  bool compress_input(bool last)
+  {
+    if (failed)
+      return false;
+    failed = !compress(pbase(), pptr() - pbase(), last);
+    setp(input.data(), input.data() + input.size());
+    return !failed;
+  }
+
+  /// Write compressed data to file.
+  bool write_output(size_t size)
+  {
+    return (bool)file.write(output.data(), size);
+  }
+
+  int overflow(int c)
+  {
+    if (!compress_input(false))
+      return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  streamsize xsputn(const char* data, streamsize size)
+  {
+    // large blocks are compressed in place instead of copied
+    if (size < epptr() - pptr())
+      return streambuf::xsputn(data, size);
+    if (!compress_input(false))
+      return 0;
+    failed = !compress(data, size, false);
+    return failed ? 0 : size;
+  }
+
+  int sync()
+  {
+    return compress_input(false) && file.flush() ? 0 : -1;
+  }
+
+
+public:
+  /// Constructor.
+  Compressing_Buffer():
+    file(), input(1 << 18), output(1 << 18), failed(false)
+  {
+    setp(input.data(), input.data() + input.size());
+  }
+
+  /// Destructor.
+  virtual ~Compressing_Buffer() {}
+
+  /// Open file.
+  bool open(const char* filename)
+  {
+    file.open(filename, ios::binary);
+    return (bool)file;
+  }
+
+  /// Compress remaining data, end the compressed stream and close the file.
+  virtual bool finish()
+  {
+    bool ok = compress_input(true);
+    file.close();
+    return ok && !file.fail();
+  }
+};
+
+
+
+/// Gzip compressing stream buffer (zlib).
+class Gzip_Buffer : public Compressing_Buffer
+{
+protected:
+  /// Deflate state.
+  z_stream stream;
+
+  /// Is stream initialised?
+  bool initialised;
+
+  bool compress(const char* data, size_t size, bool last)
+  {
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = size;
+    int status;
+    do
+    {
+      stream.next_out = (Bytef*)output.data();
+      stream.avail_out = output.size();
+      status = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+      if (status == Z_STREAM_ERROR ||
+	  !write_output(output.size() - stream.avail_out))
+	return false;
+    }
+    while (stream.avail_out == 0 || (last && status != Z_STREAM_END));
+    return true;
+  }
+
+
+public:
+  /// Constructor.
+  Gzip_Buffer(int level = Z_DEFAULT_COMPRESSION):
+    Compressing_Buffer(), stream(), initialised(false)
+  {
+    // window bits + 16: gzip header and trailer
+    initialised = deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+			       Z_DEFAULT_STRATEGY) == Z_OK;
+    failed = !initialised;
+  }
+
+  /// Destructor.
+  ~Gzip_Buffer()
+  {
+    if (initialised)
+      deflateEnd(&stream);
+  }
+};
+
+
+
+#ifdef HAVE_ZSTD
+/// Zstandard compressing stream buffer.
+class Zstd_Buffer : public Compressing_Buffer
+{
+protected:
+  /// Compression context.
+  ZSTD_CCtx* context;
+
+  bool compress(const char* data, size_t size, bool last)
+  {
+    ZSTD_inBuffer in = { data, size, 0 };
+    size_t remaining;
+    do
+    {
+      ZSTD_outBuffer out = { output.data(), output.size(), 0 };
+      remaining = ZSTD_compressStream2(context, &out, &in,
+				       last ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining) || !write_output(out.pos))
+	return false;
+    }
+    while (last ? remaining != 0 : in.pos < in.size);
+    return true;
+  }
+
+
+public:
+  /// Constructor.
+  Zstd_Buffer(int level = 3):
+    Compressing_Buffer(), context(ZSTD_createCCtx())
+  {
+    failed = !context ||
+      ZSTD_isError(ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, level));
+  }
+
+  /// Destructor.
+  ~Zstd_Buffer() { ZSTD_freeCCtx(context); }
+};
+#endif
+
+
+
+/// Output file, compressed by file name: gzip for .gz, Zstandard for .zst
+/// (if built with HAVE_ZSTD), uncompressed otherwise.  Uncompressed files
+/// can be written asynchronously through io_uring.
+class Output_File : public ostream
+{
+protected:
+  /// Plain file buffer.
+  filebuf plain;
+
+  /// Compressing buffer, if compressed.
+  unique_ptr<Compressing_Buffer> compressed;
+
+  /// Asynchronous buffer, if written through io_uring.
+  unique_ptr<Uring_Buffer> asynchronous;
+
+  /// Does name end with suffix?
+  static bool ends_with(const string& name, const string& suffix)
+  {
+    return name.size() >= suffix.size() &&
+      name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+
+public:
+  /// Constructor.
+  Output_File(): ostream(NULL), plain(), compressed(), asynchronous() {}
+
+  /// Destructor.
+  ~Output_File() { close(); }
+
+  /// Is file compressed by the suffix of its name?
+  static bool compressed_name(const string& name)
+  {
+    return ends_with(name, ".gz") || ends_with(name, ".zst");
+  }
+
+  /// Is compression for the suffix of filename available?
+  static bool supported(const char* filename)
+  {
+#ifndef HAVE_ZSTD
+    if (ends_with(filename, ".zst"))
+      return false;
+#endif
+    return true;
+  }
+
+  /// Open file, uncompressed ones through io_uring if asynchronous;
+  /// failbit is set on error.  With resume_at >= 0, an existing
+  /// uncompressed file is cut to resume_at bytes and appended to.
+  void open(const char* filename, bool async = false, off_t resume_at = -1)
+  {
+    string name(filename);
+    if (!supported(filename) || (resume_at >= 0 && compressed_name(name)) ||
+	(resume_at >= 0 && truncate(filename, resume_at) != 0))
+    {
+      setstate(ios::failbit);
+      return;
+    }
+    if (ends_with(name, ".gz"))
+      compressed.reset(new Gzip_Buffer);
+#ifdef HAVE_ZSTD
+    else if (ends_with(name, ".zst"))
+      compressed.reset(new Zstd_Buffer);
+#endif
+    else if (async)
+      asynchronous.reset(new Uring_Buffer);
+    if (compressed)
+    {
+      if (compressed->open(filename))
+	rdbuf(compressed.get());
+    }
+    else if (asynchronous)
+    {
+      if (asynchronous->open(filename, resume_at >= 0))
+	rdbuf(asynchronous.get());
+    }
+    else if (plain.open(filename, ios::out | (resume_at >= 0 ? ios::app : ios::trunc) | ios::binary))
+      rdbuf(&plain);
+    if (!rdbuf())
+      setstate(ios::failbit);
+  }
+
+  /// Flush and close file; false if any data could not be written.
+  bool close()
+  {
+    if (!rdbuf())
+      return true;
+    bool ok = compressed ? compressed->finish() :
+      asynchronous ? asynchronous->finish() : plain.close() != NULL;
+    // writes that failed before (e.g. on a full disk) left failbit or badbit
+    ok = ok && !fail();
+    rdbuf(NULL);
+    compressed.reset();
+    asynchronous.reset();
+    return ok;
+  }
+
+  /// Is file written through io_uring (and not with the pwrite fallback)?
+  bool uring() const { return asynchronous && asynchronous->uring(); }
+};
+
+
+#endif
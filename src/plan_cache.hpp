@@ -0,0 +1,233 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef PLAN_CACHE_HPP
+#define PLAN_CACHE_HPP
+
+#include <atomic>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "basics.hpp"
+#include "dijkstra.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Key of a cached plan.
+struct Plan_Key
+{
+  /// Source vertex (external ID).
+  long source;
+
+  /// Destination vertex (external ID).
+  long destination;
+
+  /// NFA index.
+  int nfa;
+
+  /// Quantised start time.
+  long bucket;
+
+  /// Epoch of the edge costs.
+  unsigned long epoch;
+
+  /// Equal-operator.
+  bool operator==(const Plan_Key& other) const
+  {
+    return source == other.source && destination == other.destination &&
+      nfa == other.nfa && bucket == other.bucket && epoch == other.epoch;
+  }
+};
+
+
+/// Hash for Plan_Key.
+struct Plan_Key_Hash
+{
+  size_t operator()(const Plan_Key& key) const
+  {
+    size_t h = (size_t)key.source * 0x9e3779b97f4a7c15ULL;
+    h ^= (size_t)key.destination + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= (size_t)key.nfa + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= (size_t)key.bucket + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= (size_t)key.epoch + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+  }
+};
+
+
+
+/// Thread-safe plan cache.
+/// Plans are keyed by (source, destination, NFA, start time bucket, edge
+/// cost epoch) and kept in independently locked LRU shards, each owning an
+/// equal share of the memory limit.  Plans are stored with the start time they were
+/// computed for and shifted to the requested start time on a hit; with
+/// time-independent costs this reproduces the searched plan exactly.
+class Plan_Cache
+{
+protected:
+  /// Cached plan.
+  struct Entry
+  {
+    Plan_Key key;
+    Plan plan;
+    float start_time;
+    size_t bytes;
+  };
+
+  /// LRU shard; most recently used entries first.
+  struct Shard
+  {
+    mutex lock;
+    list<Entry> entries;
+    unordered_map<Plan_Key, list<Entry>::iterator, Plan_Key_Hash> index;
+    size_t bytes;
+
+    Shard(): lock(), entries(), index(), bytes(0) {}
+  };
+
+  /// Shards.
+  vector<Shard> shards;
+
+  /// Memory limit per shard in bytes.
+  size_t shard_limit;
+
+  /// Length of a start time bucket.
+  float time_quantum;
+
+  /// Statistics.
+  atomic<unsigned long> nmb_hits;
+  atomic<unsigned long> nmb_misses;
+  atomic<unsigned long> nmb_evictions;
+
+  /// Build key for trip.
+  Plan_Key key(const Trip_Request& trip, unsigned long epoch) const
+  {
+    Plan_Key k;
+    k.source = trip.source;
+    k.destination = trip.destination;
+    k.nfa = (int)trip.nfaID;
+    k.bucket = time_quantum > 0 ? (long)floor(trip.start_time / time_quantum) : 0;
+    k.epoch = epoch;
+    return k;
+  }
+
+  /// Shard responsible for key.
+  Shard& shard(const Plan_Key& k)
+  {
+    return shards[Plan_Key_Hash()(k) % shards.size()];
+  }
+
+  /// Approximate memory used by an entry.
+  static size_t entry_bytes(const Plan& plan)
+  {
+    return sizeof(Entry) + 4 * sizeof(void*)
+      + plan.path.size() * (sizeof(Location) + 2 * sizeof(void*));
+  }
+
+
+public:
+  /// Constructor.
+  /// \param memory_limit  total memory for cached plans in bytes
+  /// \param quantum       start time bucket length (0: ignore start time)
+  /// \param nmb_shards    number of independently locked shards
+  Plan_Cache(size_t memory_limit, float quantum, unsigned int nmb_shards = 64):
+    shards(nmb_shards), shard_limit(memory_limit / nmb_shards),
+    time_quantum(quantum), nmb_hits(0), nmb_misses(0), nmb_evictions(0) {}
+
+  /// Look up plan for trip computed on the edge costs of epoch; on a hit
+  /// the plan is copied and time-shifted.
+  bool lookup(const Trip_Request& trip, Plan& plan, unsigned long epoch = 0);
+
+  /// Insert plan computed for trip on the edge costs of epoch.  Plans of
+  /// old epochs are never hit again and age out of the cache.
+  void insert(const Trip_Request& trip, const Plan& plan, unsigned long epoch = 0);
+
+  /// Return statistics string.
+  string statistics();
+};
+
+
+bool Plan_Cache::lookup(const Trip_Request& trip, Plan& plan, unsigned long epoch)
+{
+  Plan_Key k = key(trip, epoch);
+  Shard& s = shard(k);
+  {
+    lock_guard<mutex> guard(s.lock);
+    unordered_map<Plan_Key, list<Entry>::iterator, Plan_Key_Hash>::iterator it =
+      s.index.find(k);
+    if (it != s.index.end())
+    {
+      s.entries.splice(s.entries.begin(), s.entries, it->second);
+      plan = it->second->plan;
+      float shift = trip.start_time - it->second->start_time;
+      if (shift != 0)
+	for (Plan_Iterator loc = plan.path.begin(); loc != plan.path.end(); ++loc)
+	  loc->time += shift;
+      ++nmb_hits;
+      return true;
+    }
+  }
+  ++nmb_misses;
+  return false;
+}
+
+
+void Plan_Cache::insert(const Trip_Request& trip, const Plan& plan, unsigned long epoch)
+{
+  Plan_Key k = key(trip, epoch);
+  size_t bytes = entry_bytes(plan);
+  if (bytes > shard_limit)
+    return;
+
+  Shard& s = shard(k);
+  lock_guard<mutex> guard(s.lock);
+  if (s.index.find(k) != s.index.end())
+    return;
+  while (!s.entries.empty() && s.bytes + bytes > shard_limit)
+  {
+    s.bytes -= s.entries.back().bytes;
+    s.index.erase(s.entries.back().key);
+    s.entries.pop_back();
+    ++nmb_evictions;
+  }
+  Entry entry;
+  entry.key = k;
+  entry.plan = plan;
+  entry.start_time = trip.start_time;
+  entry.bytes = bytes;
+  s.entries.push_front(entry);
+  s.index[k] = s.entries.begin();
+  s.bytes += bytes;
+}
+
+
+string Plan_Cache::statistics()
+{
+  size_t entries = 0, bytes = 0;
+  for (size_t i = 0; i < shards.size(); ++i)
+  {
+    lock_guard<mutex> guard(shards[i].lock);
+    entries += shards[i].entries.size();
+    bytes += shards[i].bytes;
+  }
+  unsigned long lookups = nmb_hits + nmb_misses;
+  return "Plan cache: " + itos(nmb_hits) + " hits, " + itos(nmb_misses)
+    + " misses (" + ftos(lookups ? 100.0 * nmb_hits / lookups : 0.0)
+    + "% hit rate), " + itos(nmb_evictions) + " evictions, "
+    + itos(entries) + " entries, " + itos(bytes / 1024) + " kB.";
+}
+
+
+#endif
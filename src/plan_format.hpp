@@ -0,0 +1,250 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef PLAN_FORMAT_HPP
+#define PLAN_FORMAT_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Binary plan file format.
+/// Header: magic "RRPLANS" + format version byte, then the time quantum
+/// (f64, little-endian).  A sequence of self-contained trip records
+/// follows, so that records encoded by different workers can be
+/// concatenated in any order:
+///
+///   varint  trip ID
+///   zigzag  source vertex
+///   zigzag  destination - source
+///   varint  2 x number of locations + budget exceeded flag
+///   per location:
+///     zigzag  vertex - previous vertex (the first one relative to source)
+///     zigzag  time / quantum - previous (the first one absolute)
+///   varint  number of label runs, per run: zigzag label, varint length
+///           (labels of all locations but the first)
+///
+/// Varints are unsigned LEB128; zigzag maps signed to unsigned varints.
+/// Times are rounded to multiples of the quantum, so the text format is
+/// reproduced exactly for times that are multiples of it.
+const char PLAN_MAGIC[8] = { 'R', 'R', 'P', 'L', 'A', 'N', 'S', 1 };
+
+
+/// Default time quantum in seconds.
+const double PLAN_TIME_QUANTUM = 0.001;
+
+
+/// Largest number of locations accepted in a record.
+const uint64_t MAX_PLAN_LOCATIONS = 1 << 28;
+
+
+
+/// Location of a decoded plan.
+struct Plan_Location
+{
+  long vertex;
+  float time;
+  int label;
+};
+
+
+/// Decoded trip record.
+struct Plan_Record
+{
+  unsigned long id;
+  long source;
+  long destination;
+  bool budget_exceeded;
+  vector<Plan_Location> path;
+};
+
+
+
+/// Append unsigned varint.
+void put_varint(string& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+
+/// Append signed varint (zigzag).
+void put_zigzag(string& out, int64_t value)
+{
+  put_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+/// Read unsigned varint; false at end of input or on overlong encoding.
+bool get_varint(istream& in, uint64_t& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    int c = in.get();
+    if (c == EOF)
+      return false;
+    value |= (uint64_t)(c & 0x7f) << shift;
+    if (!(c & 0x80))
+      return true;
+  }
+  return false;
+}
+
+
+/// Read signed varint (zigzag).
+bool get_zigzag(istream& in, int64_t& value)
+{
+  uint64_t raw;
+  if (!get_varint(in, raw))
+    return false;
+  value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+  return true;
+}
+
+
+
+/// Write file header.
+void write_plan_header(ostream& out, double quantum)
+{
+  unsigned char bytes[8];
+  uint64_t bits;
+  memcpy(&bits, &quantum, 8);
+  for (int i = 0; i < 8; ++i)
+    bytes[i] = (unsigned char)(bits >> (8 * i));
+  out.write(PLAN_MAGIC, 8);
+  out.write((const char*)bytes, 8);
+}
+
+
+/// Read file header; false if input is no binary plan file.
+bool read_plan_header(istream& in, double& quantum)
+{
+  char magic[8];
+  unsigned char bytes[8];
+  if (!in.read(magic, 8) || memcmp(magic, PLAN_MAGIC, 8) != 0 ||
+      !in.read((char*)bytes, 8))
+    return false;
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i)
+    bits |= (uint64_t)bytes[i] << (8 * i);
+  memcpy(&quantum, &bits, 8);
+  return quantum > 0;
+}
+
+
+/// Append trip record of a path given by locations [begin, end) with
+/// members external_id, time and edge_label.
+template <class Location_It>
+void encode_plan(string& out, unsigned long id, long source, long destination,
+		 bool budget_exceeded, Location_It begin, Location_It end,
+		 double quantum)
+{
+  put_varint(out, id);
+  put_zigzag(out, source);
+  put_zigzag(out, destination - source);
+
+  size_t nmb_locations = 0;
+  for (Location_It it = begin; it != end; ++it)
+    ++nmb_locations;
+  put_varint(out, 2 * nmb_locations + (budget_exceeded ? 1 : 0));
+
+  long vertex = source;
+  int64_t time = 0;
+  for (Location_It it = begin; it != end; ++it)
+  {
+    int64_t curr_time = llround(it->time / quantum);
+    put_zigzag(out, it->external_id - vertex);
+    put_zigzag(out, curr_time - time);
+    vertex = it->external_id;
+    time = curr_time;
+  }
+
+  // label runs over all locations but the first
+  if (nmb_locations < 2)
+  {
+    put_varint(out, 0);
+    return;
+  }
+  vector<pair<int, uint64_t> > runs;
+  Location_It it = begin;
+  for (++it; it != end; ++it)
+    if (!runs.empty() && runs.back().first == it->edge_label)
+      ++runs.back().second;
+    else
+      runs.push_back(make_pair((int)it->edge_label, (uint64_t)1));
+  put_varint(out, runs.size());
+  for (size_t r = 0; r < runs.size(); ++r)
+  {
+    put_zigzag(out, runs[r].first);
+    put_varint(out, runs[r].second);
+  }
+}
+
+
+/// Read next trip record; false at end of input or on a truncated record.
+bool decode_plan(istream& in, double quantum, Plan_Record& record)
+{
+  uint64_t id, size, nmb_runs;
+  int64_t source, destination;
+  if (!get_varint(in, id) || !get_zigzag(in, source) ||
+      !get_zigzag(in, destination) || !get_varint(in, size))
+    return false;
+  record.id = id;
+  record.source = source;
+  record.destination = source + destination;
+  record.budget_exceeded = size & 1;
+  if (size / 2 > MAX_PLAN_LOCATIONS)
+    return false;
+  record.path.resize(size / 2);
+
+  int64_t vertex = source;
+  int64_t time = 0;
+  for (size_t i = 0; i < record.path.size(); ++i)
+  {
+    int64_t vertex_delta, time_delta;
+    if (!get_zigzag(in, vertex_delta) || !get_zigzag(in, time_delta))
+      return false;
+    vertex += vertex_delta;
+    time += time_delta;
+    record.path[i].vertex = vertex;
+    record.path[i].time = (float)(time * quantum);
+    record.path[i].label = -1;
+  }
+
+  if (!get_varint(in, nmb_runs))
+    return false;
+  size_t i = 1;
+  for (uint64_t r = 0; r < nmb_runs; ++r)
+  {
+    int64_t label;
+    uint64_t length;
+    if (!get_zigzag(in, label) || !get_varint(in, length) ||
+	length > record.path.size() || i + length > record.path.size())
+      return false;
+    for (uint64_t k = 0; k < length; ++k)
+      record.path[i++].label = label;
+  }
+  return true;
+}
+
+
+#endif
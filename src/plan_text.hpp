@@ -0,0 +1,80 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef PLAN_TEXT_HPP
+#define PLAN_TEXT_HPP
+
+#include <charconv>
+#include <string>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Text plan format, appended to string buffers with to_chars.
+/// One line per trip:
+///
+///   id  source  destination  number of locations  [budget_exceeded]
+///   vertex  time  (first location)
+///   vertex  time  label  (all further locations)
+///
+/// each field followed by a tab.  Numbers are formatted exactly like
+/// ostream << with default flags, i.e. times with six significant digits,
+/// so the output is byte-identical to formatting with streams.
+
+/// Significant digits of times (default precision of ostream).
+const int PLAN_TEXT_PRECISION = 6;
+
+
+/// Append integer and a tab.
+template <class Integer>
+void append_field(string& out, Integer value)
+{
+  char buffer[24];
+  char* end = to_chars(buffer, buffer + sizeof(buffer) - 1, value).ptr;
+  *end++ = '\t';
+  out.append(buffer, end);
+}
+
+
+/// Append time and a tab.
+void append_time(string& out, float time)
+{
+  char buffer[32];
+  char* end = to_chars(buffer, buffer + sizeof(buffer) - 1, time,
+		       chars_format::general, PLAN_TEXT_PRECISION).ptr;
+  *end++ = '\t';
+  out.append(buffer, end);
+}
+
+
+/// Append start of a plan line: trip, plan size and budget flag.
+void append_plan_head(string& out, unsigned long id, long source, long destination,
+		      unsigned int plan_size, bool budget_exceeded)
+{
+  append_field(out, id);
+  append_field(out, source);
+  append_field(out, destination);
+  append_field(out, plan_size);
+  if (budget_exceeded)
+    out.append("budget_exceeded\t");
+}
+
+
+/// Append location of a plan line; the first location has no label.
+void append_location(string& out, long vertex, float time, int label, bool first)
+{
+  append_field(out, vertex);
+  append_time(out, time);
+  if (!first)
+    append_field(out, label);
+}
+
+
+#endif
@@ -0,0 +1,247 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef PLAN_WRITER_HPP
+#define PLAN_WRITER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <log4cplus/logger.h>
+#include <log4cplus/loggingmacros.h>
+
+#include "bounded_queue.hpp"
+#include "checkpoint.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Formatted output of one worker.
+struct Output_Chunk
+{
+  /// Position of chunk in output (ordered mode only).
+  size_t sequence;
+
+  /// Formatted plans.
+  string text;
+
+  /// Batches completed by the chunk (with a checkpoint only).
+  vector<size_t> batches;
+};
+
+
+
+/// Writer thread for formatted plans.
+/// Workers format plans into their own chunks and hand them over through a
+/// lock-free queue; a dedicated thread writes them to the stream, so workers
+/// never wait for I/O.  In ordered mode chunks carry consecutive sequence
+/// numbers and are written in that order.  Chunks arriving early are held
+/// back, but at most window of them: a worker running further ahead waits
+/// in submit() until the writer has caught up.  Written chunks are handed
+/// back to the workers through new_chunk(), so their buffers are reused.
+class Plan_Writer
+{
+protected:
+  /// Output stream.
+  ostream& out;
+
+  /// Write chunks in sequence order?
+  bool ordered;
+
+  /// Maximum number of chunks held back in ordered mode.
+  size_t window;
+
+  /// Chunks handed over by workers.
+  Bounded_Queue<Output_Chunk*> queue;
+
+  /// Written chunks for reuse, with their buffers.
+  Bounded_Queue<Output_Chunk*> recycled;
+
+  /// Sequence number of next chunk to be written (ordered mode).
+  atomic<size_t> next_sequence;
+
+  /// Have all chunks been submitted?
+  atomic<bool> closing;
+
+  /// Progress of the run (NULL: none).
+  Checkpoint* checkpoint;
+
+  /// Time between checkpoints.
+  chrono::steady_clock::duration checkpoint_interval;
+
+  /// Time of next checkpoint.
+  chrono::steady_clock::time_point next_checkpoint;
+
+  /// Writer thread.
+  std::thread writer;
+
+  /// Writer thread main loop.
+  void run();
+
+  /// Save checkpoint if due (or now).
+  void save_checkpoint(bool now = false);
+
+  /// Write chunk and recycle it.
+  void write(Output_Chunk* chunk)
+  {
+    out.write(chunk->text.data(), chunk->text.size());
+    if (checkpoint)
+      checkpoint->written(chunk->batches, chunk->text.size());
+    chunk->text.clear();
+    chunk->batches.clear();
+    if (!recycled.try_push(chunk))
+      delete chunk;
+  }
+
+
+public:
+  /// Constructor; starts the writer thread.
+  Plan_Writer(ostream& o, bool in_order, size_t reorder_window = 256):
+    out(o), ordered(in_order), window(reorder_window),
+    queue(2 * reorder_window), recycled(64), next_sequence(0), closing(false),
+    checkpoint(NULL), checkpoint_interval(), next_checkpoint(), writer()
+  {
+    writer = std::thread(&Plan_Writer::run, this);
+  }
+
+  /// Destructor.
+  ~Plan_Writer();
+
+  /// Get an empty chunk, a written one if available.
+  Output_Chunk* new_chunk()
+  {
+    Output_Chunk* chunk;
+    if (recycled.try_pop(chunk))
+      return chunk;
+    return new Output_Chunk;
+  }
+
+  /// Save progress to checkpoint every interval seconds and after the
+  /// last chunk; chunks list the batches they complete.  To be set before
+  /// the first chunk is submitted.  In ordered mode writing continues
+  /// after the completed prefix of batches.
+  void set_checkpoint(Checkpoint* progress, double interval);
+
+  /// Hand over chunk; the writer takes ownership.
+  void submit(Output_Chunk* chunk);
+
+  /// Write all submitted chunks and stop the writer thread.
+  void close();
+};
+
+
+Plan_Writer::~Plan_Writer()
+{
+  close();
+  Output_Chunk* chunk;
+  while (recycled.try_pop(chunk))
+    delete chunk;
+}
+
+
+void Plan_Writer::set_checkpoint(Checkpoint* progress, double interval)
+{
+  checkpoint = progress;
+  checkpoint_interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(interval));
+  next_checkpoint = chrono::steady_clock::now() + checkpoint_interval;
+  const vector<bool>& done = checkpoint->done();
+  size_t next = 0;
+  while (next < done.size() && done[next])
+    ++next;
+  next_sequence.store(next, memory_order_release);
+}
+
+
+void Plan_Writer::save_checkpoint(bool now)
+{
+  if (!checkpoint || (!now && chrono::steady_clock::now() < next_checkpoint))
+    return;
+  out.flush();
+  if (!out || !checkpoint->save())
+    LOG4CPLUS_ERROR(log4cplus::Logger::getInstance("Plan_Writer"), "Could not save the checkpoint.");
+  next_checkpoint = chrono::steady_clock::now() + checkpoint_interval;
+}
+
+
+void Plan_Writer::submit(Output_Chunk* chunk)
+{
+  Back_Off back_off;
+  if (ordered)
+    while (chunk->sequence >= next_sequence.load(memory_order_acquire) + window)
+      back_off.wait();
+  back_off.reset();
+  while (!queue.try_push(chunk))
+    back_off.wait();
+}
+
+
+void Plan_Writer::close()
+{
+  if (writer.joinable())
+  {
+    closing.store(true, memory_order_release);
+    writer.join();
+    out.flush();
+    save_checkpoint(true);
+  }
+}
+
+
+void Plan_Writer::run()
+{
+  map<size_t, Output_Chunk*> pending;
+  Back_Off back_off;
+  Output_Chunk* chunk;
+  for (;;)
+  {
+    if (!queue.try_pop(chunk))
+    {
+      if (!closing.load(memory_order_acquire))
+      {
+	save_checkpoint();
+	back_off.wait();
+	continue;
+      }
+      // closing is only set once all submits have returned
+      if (!queue.try_pop(chunk))
+	break;
+    }
+    back_off.reset();
+    save_checkpoint();
+
+    if (!ordered)
+    {
+      write(chunk);
+      continue;
+    }
+    pending[chunk->sequence] = chunk;
+    size_t next = next_sequence.load(memory_order_relaxed);
+    map<size_t, Output_Chunk*>::iterator it;
+    while ((it = pending.begin()) != pending.end() && it->first == next)
+    {
+      write(it->second);
+      pending.erase(it);
+      next_sequence.store(++next, memory_order_release);
+    }
+  }
+
+  // chunks left after a gap are written rather than lost
+  for (map<size_t, Output_Chunk*>::iterator it = pending.begin();
+       it != pending.end(); ++it)
+    write(it->second);
+}
+
+
+#endif
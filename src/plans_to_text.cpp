@@ -0,0 +1,96 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  Convert a binary plan file (new_main --binary) into the text plan file
+  format of new_main.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "output_file.hpp"
+#include "plan_format.hpp"
+#include "plan_text.hpp"
+
+using namespace std;
+
+
+/// Append record as a line of the text plan format.
+void write_text(string& out, const Plan_Record& record)
+{
+  append_plan_head(out, record.id, record.source, record.destination,
+		   record.path.size(), record.budget_exceeded);
+  if (!record.budget_exceeded)
+    for (size_t i = 0; i < record.path.size(); ++i)
+      append_location(out, record.path[i].vertex, record.path[i].time,
+		      record.path[i].label, i == 0);
+  out += '\n';
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    cout << "Usage: plans_to_text <binary plans> [<output>]" << endl
+	 << " Writes the plans of a binary plan file in text format to output"
+	 << " (default standard output; .gz or .zst: compressed)." << endl;
+    return 0;
+  }
+
+  ifstream in(argv[1], ios::binary);
+  if (!in)
+  {
+    cout << "Sorry, could not open file " << argv[1] << ". Bye!" << endl;
+    exit(-1);
+  }
+  double quantum;
+  if (!read_plan_header(in, quantum))
+  {
+    cout << "Sorry, " << argv[1] << " is no binary plan file. Bye!" << endl;
+    exit(-1);
+  }
+
+  Output_File out_file;
+  if (argc > 2)
+  {
+    out_file.open(argv[2]);
+    if (!out_file)
+    {
+      cout << "Sorry, could not open file " << argv[2] << ". Bye!" << endl;
+      exit(-1);
+    }
+  }
+  ostream& out = argc > 2 ? out_file : cout;
+
+  const size_t flush_bytes = 1 << 20;
+  Plan_Record record;
+  string buffer;
+  while (in.peek() != EOF)
+  {
+    if (!decode_plan(in, quantum, record))
+    {
+      cerr << "Sorry, truncated record in " << argv[1] << ". Bye!" << endl;
+      exit(-1);
+    }
+    write_text(buffer, record);
+    if (buffer.size() >= flush_bytes)
+    {
+      out.write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+  out.write(buffer.data(), buffer.size());
+  if (!out_file.close())
+  {
+    cerr << "Sorry, could not write all plans to " << argv[2] << ". Bye!" << endl;
+    exit(-1);
+  }
+  return 0;
+}
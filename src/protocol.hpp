@@ -0,0 +1,244 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Router daemon protocol.
+/// Every message is a frame: body length (u32) followed by the body, whose
+/// first byte is the message type.  Integers are little-endian, floats are
+/// IEEE single precision sent as u32.
+///
+///   ROUTE     client -> server  f32 max travel time, u64 max settled
+///                               vertices, f32 max seconds per search (0:
+///                               limit of the daemon), u32 n, n x (u64 id,
+///                               i64 source, i64 destination, f32 start
+///                               time, u32 NFA)
+///   PLANS     server -> client  u32 n, n x (u64 id, i64 source,
+///                               i64 destination, u8 status (PLAN_*),
+///                               u32 length, length x (i64 vertex,
+///                               f32 time, i32 label))
+///   DONE      server -> client  u64 number of plans of the request
+///   ERROR     server -> client  message text
+///   SHUTDOWN  client -> server  (empty)
+///   COSTS     client -> server  u32 n, n x (i64 tail, i64 head, i32 label,
+///                               f32 cost); answered by DONE with the new
+///                               cost epoch, or ERROR
+///
+/// A client may send any number of ROUTE messages on one connection.  The
+/// plans of each are streamed back in request order in one or more PLANS
+/// messages, followed by DONE.  Trips with unknown vertices or NFA get an
+/// empty plan, like trips without a route.  New link costs apply to the
+/// queries started after they are published; queries already running
+/// finish on the costs they started with.
+enum Message_Type
+{
+  MSG_ROUTE = 1,
+  MSG_PLANS = 2,
+  MSG_DONE = 3,
+  MSG_ERROR = 4,
+  MSG_SHUTDOWN = 5,
+  MSG_COSTS = 6
+};
+
+
+/// Status of a plan in a PLANS message.
+enum Plan_Status
+{
+  PLAN_OK = 0,
+  PLAN_BUDGET_EXCEEDED = 1
+};
+
+
+/// Largest accepted message body.
+const uint32_t MAX_MESSAGE_BYTES = 1u << 30;
+
+
+
+/// Builder of a message body.
+class Message_Writer
+{
+protected:
+  /// Body.
+  string body;
+
+public:
+  /// Constructor.
+  Message_Writer(Message_Type type): body(1, (char)type) {}
+
+  /// Append unsigned integer of given size.
+  void put(uint64_t value, int bytes)
+  {
+    for (int i = 0; i < bytes; ++i)
+      body.push_back((char)(value >> (8 * i)));
+  }
+
+  void put_u8(uint8_t value) { put(value, 1); }
+  void put_u32(uint32_t value) { put(value, 4); }
+  void put_u64(uint64_t value) { put(value, 8); }
+  void put_i32(int32_t value) { put((uint32_t)value, 4); }
+  void put_i64(int64_t value) { put((uint64_t)value, 8); }
+
+  void put_f32(float value)
+  {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    put(bits, 4);
+  }
+
+  void put_string(const string& text) { body += text; }
+
+  /// Overwrite u32 at given body position (e.g. a count written ahead).
+  void set_u32(size_t pos, uint32_t value)
+  {
+    for (int i = 0; i < 4; ++i)
+      body[pos + i] = (char)(value >> (8 * i));
+  }
+
+  /// Get body.
+  const string& data() const { return body; }
+
+  /// Get body size.
+  size_t size() const { return body.size(); }
+};
+
+
+
+/// Reader of a message body.
+class Message_Reader
+{
+protected:
+  /// Body.
+  const string& body;
+
+  /// Read position.
+  size_t pos;
+
+  /// Has a read run past the end?
+  bool failed;
+
+public:
+  /// Constructor; positioned after the type byte.
+  Message_Reader(const string& b): body(b), pos(1), failed(false) {}
+
+  /// Get message type.
+  Message_Type type() const { return (Message_Type)(body.empty() ? 0 : (unsigned char)body[0]); }
+
+  /// Read unsigned integer of given size.
+  uint64_t get(int bytes)
+  {
+    if (pos + bytes > body.size())
+    {
+      failed = true;
+      return 0;
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i)
+      value |= (uint64_t)(unsigned char)body[pos + i] << (8 * i);
+    pos += bytes;
+    return value;
+  }
+
+  uint8_t get_u8() { return (uint8_t)get(1); }
+  uint32_t get_u32() { return (uint32_t)get(4); }
+  uint64_t get_u64() { return get(8); }
+  int32_t get_i32() { return (int32_t)(uint32_t)get(4); }
+  int64_t get_i64() { return (int64_t)get(8); }
+
+  float get_f32()
+  {
+    uint32_t bits = (uint32_t)get(4);
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+  }
+
+  string get_string() { string text = body.substr(min(pos, body.size())); pos = body.size(); return text; }
+
+  /// Number of unread bytes.
+  size_t remaining() const { return pos < body.size() ? body.size() - pos : 0; }
+
+  /// Were all reads within the body?
+  bool ok() const { return !failed; }
+};
+
+
+
+/// Write all bytes; false on error.
+bool write_all(int fd, const char* data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+
+/// Read all bytes; false on error or end of stream.
+bool read_all(int fd, char* data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t n = read(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+
+/// Send message; false on error.
+bool send_message(int fd, const Message_Writer& message)
+{
+  char header[4];
+  uint32_t size = message.size();
+  for (int i = 0; i < 4; ++i)
+    header[i] = (char)(size >> (8 * i));
+  return write_all(fd, header, 4) && write_all(fd, message.data().data(), size);
+}
+
+
+/// Receive message body; false on error, end of stream or oversized message.
+bool receive_message(int fd, string& body)
+{
+  unsigned char header[4];
+  if (!read_all(fd, (char*)header, 4))
+    return false;
+  uint32_t size = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+  if (size == 0 || size > MAX_MESSAGE_BYTES)
+    return false;
+  body.resize(size);
+  return read_all(fd, &body[0], size);
+}
+
+
+#endif
@@ -12,6 +12,7 @@
 
 #include "dijkstra.hpp"
 #include "graph.hpp"
+#include "nfa_compiler.hpp"
 #include "timer.hpp"
 
 #include <log4cplus/layout.h>
@@ -357,8 +358,8 @@ void print_usage()
        << " -g <graph>   graph (edge) file" << endl
        << " -i           information output" << endl
        << " -l           labeling in visualization" << endl
-       << " -n <NFA>     NFA file" << endl
-       << " -N <NFAFile> file specifying nfa collection" << endl
+       << " -n <NFA>     NFA file or re:<label expression>, e.g. re:w*a*w*" << endl
+       << " -N <NFAFile> file specifying nfa collection (NFA files or re:<expression>)" << endl
        << " -o <results  filename> filename for results - will not overwrite unless -z given"
        << " -p <seed>    pseudo-random seed" << endl
        << " -r <nmb>     random queries" << endl
@@ -405,7 +406,7 @@ int main(int argc, char *argv[])
 
   unsigned singleNFA = 1;
 
-  while ((c = getopt(argc, argv, "a:c:d:f:g:ilnN:o:p:r:s:t:v:z")) != -1)
+  while ((c = getopt(argc, argv, "a:c:d:f:g:iln:N:o:p:r:s:t:v:z")) != -1)
   {
     int algo = 0;
 
@@ -524,7 +525,7 @@ int main(int argc, char *argv[])
 
   if (singleNFA == 1)
   {
-    NFA_Graph *nfa = new NFA_Graph(nfa_filename, network);
+    NFA_Graph *nfa = load_nfa(nfa_filename, network);
     nfaVector.push_back(nfa);
   }
   else
@@ -550,7 +551,7 @@ int main(int argc, char *argv[])
     {
       file.getline(buffer, 5000, '\n');
       cout << "NFA: " << i << "\t" << buffer << endl;
-      NFA_Graph *nfa = new NFA_Graph(buffer, network);
+      NFA_Graph *nfa = load_nfa(buffer, network);
       nfaVector.push_back(nfa);
     }
   }
@@ -617,7 +618,7 @@ int main(int argc, char *argv[])
              << trip_request.source << '\t'
              << trip_request.destination << '\t';
 
-    out_file << plan << endl;
+    out_file << plan << '\n';
 
     //distance = plan.path.back().time;
     //event_handler.print_measurements();
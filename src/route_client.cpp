@@ -0,0 +1,291 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  Send trips to a routing daemon (new_main --serve) and write the plans in
+  the plan file format of new_main.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "output_file.hpp"
+#include "plan_text.hpp"
+#include "protocol.hpp"
+#include "trip_text.hpp"
+
+using namespace std;
+
+
+/// Trips per ROUTE message.
+const uint32_t REQUEST_TRIPS = 65536;
+
+
+/// Connect to daemon socket; exits on error.
+int connect_to(const char* socket_path)
+{
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+  {
+    cout << "Sorry, could not connect to " << socket_path << " (" << strerror(errno) << "). Bye!" << endl;
+    exit(-1);
+  }
+  return fd;
+}
+
+
+/// Send one ROUTE message and write the plans received; returns number of plans.
+size_t route(int fd, const Message_Writer& request, ostream& out)
+{
+  if (!send_message(fd, request))
+  {
+    cout << "Sorry, lost connection to the router. Bye!" << endl;
+    exit(-1);
+  }
+
+  string body, text;
+  size_t nmb_plans = 0;
+  while (receive_message(fd, body))
+  {
+    Message_Reader reader(body);
+    if (reader.type() == MSG_DONE)
+      return nmb_plans;
+    if (reader.type() == MSG_ERROR)
+    {
+      cout << "Router error: " << reader.get_string() << " Bye!" << endl;
+      exit(-1);
+    }
+
+    uint32_t count = reader.get_u32();
+    text.clear();
+    for (uint32_t p = 0; p < count && reader.ok(); ++p)
+    {
+      uint64_t id = reader.get_u64();
+      int64_t source = reader.get_i64();
+      int64_t destination = reader.get_i64();
+      uint8_t status = reader.get_u8();
+      uint32_t length = reader.get_u32();
+      append_plan_head(text, id, source, destination, length,
+                       status == PLAN_BUDGET_EXCEEDED);
+      for (uint32_t i = 0; i < length && reader.ok(); ++i)
+      {
+        int64_t vertex = reader.get_i64();
+        float time = reader.get_f32();
+        int32_t label = reader.get_i32();
+        append_location(text, vertex, time, label, i == 0);
+      }
+      text += '\n';
+    }
+    if (!reader.ok())
+      break;
+    out.write(text.data(), text.size());
+    nmb_plans += count;
+  }
+  cout << "Sorry, bad reply from the router. Bye!" << endl;
+  exit(-1);
+}
+
+
+/// Send the link costs of a network (link) file; returns the new cost epoch.
+unsigned long update_costs(int fd, const char* filename)
+{
+  ifstream links(filename);
+  if (!links)
+  {
+    cout << "Sorry, could not open file " << filename << ". Bye!" << endl;
+    exit(-1);
+  }
+
+  // same format as the network file: header, then
+  // tail_id head_id tmp1 tmp2 tmp3 tmp4 cost label
+  string header;
+  getline(links, header);
+  Message_Writer request(MSG_COSTS);
+  request.put_u32(0);
+  uint32_t count = 0;
+  long tail, head;
+  int tmp1, tmp2, tmp3, tmp4, label;
+  float cost;
+  while (links >> tail >> head >> tmp1 >> tmp2 >> tmp3 >> tmp4 >> cost >> label)
+  {
+    request.put_i64(tail);
+    request.put_i64(head);
+    request.put_i32(label);
+    request.put_f32(cost);
+    ++count;
+  }
+  request.set_u32(1, count);
+
+  string body;
+  if (!send_message(fd, request) || !receive_message(fd, body))
+  {
+    cout << "Sorry, lost connection to the router. Bye!" << endl;
+    exit(-1);
+  }
+  Message_Reader reader(body);
+  if (reader.type() != MSG_DONE)
+  {
+    cout << "Router error: " << reader.get_string() << " Bye!" << endl;
+    exit(-1);
+  }
+  return reader.get_u64();
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    cout << "Usage:" << endl
+	 << " route_client <socket> <trips> [<output>] [--max-time <time>]" << endl
+	 << "              [--max-settled <n>] [--max-seconds <s>]" << endl
+	 << " route_client <socket> --costs <links>" << endl
+	 << " route_client <socket> --shutdown" << endl
+	 << " Routes the trips of a trip file on a router started with"
+	 << " new_main --serve <socket> and writes the plans to output"
+	 << " (default plans.txt; .gz or .zst: compressed), replaces the costs of the links listed"
+	 << " in a file of network file format, or shuts the router down." << endl
+	 << " Search limits override those of the router for this run." << endl;
+    return 0;
+  }
+
+  int fd = connect_to(argv[1]);
+  if (string(argv[2]) == "--shutdown")
+  {
+    send_message(fd, Message_Writer(MSG_SHUTDOWN));
+    close(fd);
+    return 0;
+  }
+  if (string(argv[2]) == "--costs")
+  {
+    if (argc < 4)
+    {
+      cout << "No link file given. Bye!" << endl;
+      exit(-1);
+    }
+    unsigned long epoch = update_costs(fd, argv[3]);
+    close(fd);
+    cout << "Published cost epoch " << epoch << "." << endl;
+    return 0;
+  }
+
+  // search limits (0: those of the router)
+  vector<char*> files;
+  float max_travel_time = 0, max_seconds = 0;
+  unsigned long max_settled = 0;
+  for (int i = 2; i < argc; ++i)
+  {
+    string option(argv[i]);
+    if (option.compare(0, 2, "--") != 0)
+      files.push_back(argv[i]);
+    else if (i + 1 == argc)
+    {
+      cout << "No value given for " << option << ". Bye!" << endl;
+      exit(-1);
+    }
+    else if (option == "--max-time")
+      max_travel_time = atof(argv[++i]);
+    else if (option == "--max-settled")
+      max_settled = strtoul(argv[++i], NULL, 10);
+    else if (option == "--max-seconds")
+      max_seconds = atof(argv[++i]);
+    else
+    {
+      cout << "Unknown option " << option << ". Bye!" << endl;
+      exit(-1);
+    }
+  }
+  if (files.empty())
+  {
+    cout << "No trip file given. Bye!" << endl;
+    exit(-1);
+  }
+
+  ifstream trips(files[0]);
+  if (!trips)
+  {
+    cout << "Sorry, could not open file " << files[0] << ". Bye!" << endl;
+    exit(-1);
+  }
+  const char* out_filename = files.size() > 1 ? files[1] : "plans.txt";
+  Output_File out;
+  out.open(out_filename);
+  if (!out)
+  {
+    cout << "Sorry, could not open file " << out_filename << ". Bye!" << endl;
+    exit(-1);
+  }
+
+  // same fields and checks as the trip file reader of new_main; vertices
+  // and NFAs unknown to the router get empty plans
+  size_t nmb_trips = 0;
+  size_t line_number = 0;
+  string line, parse_error;
+  while (trips && parse_error.empty())
+  {
+    Message_Writer request(MSG_ROUTE);
+    request.put_f32(max_travel_time);
+    request.put_u64(max_settled);
+    request.put_f32(max_seconds);
+    size_t count_pos = request.size();
+    request.put_u32(0);
+    uint32_t count = 0;
+    Trip_Fields trip;
+    bool blank;
+    while (count < REQUEST_TRIPS && getline(trips, line))
+    {
+      ++line_number;
+      if (!parse_trip_fields(line.data(), line.data() + line.size(), trip, blank, parse_error))
+      {
+	parse_error = string(files[0]) + ":" + to_string(line_number) + ": " + parse_error + ".";
+	break;
+      }
+      if (blank)
+	continue;
+      request.put_u64(trip.id);
+      request.put_i64(trip.source);
+      request.put_i64(trip.destination);
+      request.put_f32((float)trip.start_time);
+      request.put_u32(trip.nfa);
+      ++count;
+    }
+    if (count == 0)
+      break;
+    request.set_u32(count_pos, count);
+    nmb_trips += route(fd, request, out);
+  }
+
+  close(fd);
+  if (!out.close())
+  {
+    cout << "Sorry, could not write all plans to " << out_filename << ". Bye!" << endl;
+    exit(-1);
+  }
+  if (!parse_error.empty())
+  {
+    cout << "Sorry, " << parse_error << " Plans were written for the trips read before. Bye!" << endl;
+    exit(-1);
+  }
+  if (trips.bad())
+  {
+    cout << "Sorry, could not read file " << files[0] << " (" << strerror(errno) << "). Bye!" << endl;
+    exit(-1);
+  }
+  cout << "Routed " << nmb_trips << " trips." << endl;
+  return 0;
+}
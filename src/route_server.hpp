@@ -0,0 +1,551 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef ROUTE_SERVER_HPP
+#define ROUTE_SERVER_HPP
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "edge_costs.hpp"
+#include "numa.hpp"
+#include "plan_cache.hpp"
+#include "protocol.hpp"
+#include "routing_context.hpp"
+#include "trip_batch.hpp"
+#include "work_pool.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Trips of one ROUTE request being routed by the workers.
+struct Route_Job
+{
+  /// Limits of each search.
+  Search_Budget budget;
+
+  /// Trips in request order.
+  vector<Trip_Request> trips;
+
+  /// Are vertices and NFA of each trip known?
+  vector<bool> valid;
+
+  /// Plan of each trip.
+  vector<Plan> plans;
+
+  /// Ranges of trips handed to the workers.
+  vector<size_t> boundaries;
+
+  /// Work pool over the ranges.
+  Work_Pool pool;
+
+  /// Guards finished and users.
+  mutex lock;
+
+  /// Signalled when a range is finished or a worker leaves.
+  condition_variable changed;
+
+  /// Is each range routed?
+  vector<bool> finished;
+
+  /// Number of workers on the job.
+  unsigned int users;
+
+  /// Constructor.
+  Route_Job(unsigned int nmb_workers): pool(nmb_workers), users(0) {}
+};
+
+
+
+/// Routing daemon on a Unix domain socket.
+/// Workers with their routers stay resident between requests.  Requests of
+/// all connections are routed one at a time on all workers, and plans are
+/// streamed back in request order as their ranges are finished.  Link
+/// costs are replaced (COSTS) beside running requests, which switch to
+/// them query by query.  See protocol.hpp for the messages.
+class Route_Server
+{
+protected:
+  /// Routing contexts, one per NUMA node or a single one.
+  vector<Routing_Context*>& contexts;
+
+  /// Placement of workers.
+  const Worker_Placement& placement;
+
+  /// Pin workers to their CPUs?
+  bool pin_workers;
+
+  /// Number of workers.
+  unsigned int nmb_workers;
+
+  /// Shortest path algorithm.
+  unsigned int algorithm;
+
+  /// Locality key (NULL: routing order of bundles).
+  const Locality_Key* locality;
+
+  /// Shared plan cache (NULL if disabled).
+  Plan_Cache* plan_cache;
+
+  /// Search limits of requests that set none.
+  Search_Budget default_budget;
+
+  /// Edge costs of all contexts, replaced by COSTS messages.
+  Cost_Table cost_table;
+
+  /// Trips per work range and PLANS message.
+  size_t batch_trips;
+
+  /// Listening socket.
+  int listen_fd;
+
+  /// Socket path.
+  string path;
+
+  /// Guards current, generation and stopping.
+  mutex lock;
+
+  /// Signalled when a job is posted or the workers are stopped.
+  condition_variable job_posted;
+
+  /// Job being routed (NULL if none).
+  Route_Job* current;
+
+  /// Number of jobs posted so far.
+  unsigned long generation;
+
+  /// Are the workers to stop?
+  bool stopping;
+
+  /// Serialises jobs of all connections.
+  mutex submit_lock;
+
+  /// Has a client asked for shutdown?
+  atomic<bool> closing;
+
+  /// Connection of one client.
+  struct Connection
+  {
+    int fd;
+    std::thread handler;
+    atomic<bool> done;
+  };
+
+  /// Guards connections.
+  mutex connections_lock;
+
+  /// Open connections.
+  list<Connection> connections;
+
+  /// Workers.
+  vector<std::thread> workers;
+
+  /// Route trips of one range of job.
+  void route_range(Router& router, Route_Job& job, const Work_Range& range);
+
+  /// Worker: route ranges of each job posted.
+  void worker_method(unsigned int worker);
+
+  /// Route trips of job on the workers and stream their plans to fd.
+  /// Returns false once the client cannot be written to.
+  bool route(int fd, Route_Job& job);
+
+  /// Publish link costs of a COSTS message and answer it.
+  void update_costs(int fd, Message_Reader& reader);
+
+  /// Serve one client until it closes the connection.
+  void serve(Connection& connection);
+
+  /// Join handlers of closed connections.
+  void reap_connections(bool all);
+
+public:
+  /// Constructor.
+  Route_Server(vector<Routing_Context*>& c, const Worker_Placement& p, bool pin,
+               unsigned int workers, unsigned int a, const Locality_Key* l,
+               Plan_Cache* cache, const Search_Budget& budget, size_t trips):
+    contexts(c), placement(p), pin_workers(pin), nmb_workers(workers), algorithm(a),
+    locality(l), plan_cache(cache), default_budget(budget), cost_table(c[0]->network()),
+    batch_trips(trips), listen_fd(-1), current(NULL), generation(0),
+    stopping(false), closing(false)
+  {
+    for (size_t i = 0; i < contexts.size(); ++i)
+      contexts[i]->set_cost_table(&cost_table);
+  }
+
+  /// Destructor.
+  ~Route_Server()
+  {
+    for (size_t i = 0; i < contexts.size(); ++i)
+      contexts[i]->set_cost_table(NULL);
+    if (listen_fd >= 0)
+    {
+      close(listen_fd);
+      unlink(path.c_str());
+    }
+  }
+
+  /// Listen on socket path; false (with errno set) on error.
+  /// A stale socket at path is replaced.
+  bool listen(const char* socket_path);
+
+  /// Start workers and serve clients until one sends SHUTDOWN.
+  void run();
+};
+
+
+bool Route_Server::listen(const char* socket_path)
+{
+  sockaddr_un address;
+  if (strlen(socket_path) >= sizeof(address.sun_path))
+  {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socket_path);
+
+  struct stat status;
+  if (stat(socket_path, &status) == 0 && S_ISSOCK(status.st_mode))
+    unlink(socket_path);
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0)
+    return false;
+  if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 ||
+      ::listen(listen_fd, 64) != 0)
+  {
+    int error = errno;
+    close(listen_fd);
+    listen_fd = -1;
+    errno = error;
+    return false;
+  }
+  path = socket_path;
+
+  // a client closing early must not kill the daemon
+  signal(SIGPIPE, SIG_IGN);
+  return true;
+}
+
+
+void Route_Server::route_range(Router& router, Route_Job& job, const Work_Range& range)
+{
+  Trip_Batch batch;
+  vector<size_t> position;
+  for (size_t i = range.begin; i < range.end; ++i)
+    if (job.valid[i])
+    {
+      batch.trips.push_back(job.trips[i]);
+      position.push_back(i);
+    }
+
+  vector<Plan> plans;
+  route_batch(router, algorithm, batch, locality, plans);
+  for (size_t i = 0; i < position.size(); ++i)
+    job.plans[position[i]] = plans[batch.copy_of[i]];
+}
+
+
+void Route_Server::worker_method(unsigned int worker)
+{
+  if (pin_workers)
+    pin_thread(vector<int>(1, placement.cpu_of(worker)));
+  Router router(*contexts[placement.node_of(worker) % contexts.size()]);
+  router.set_cache(plan_cache);
+
+  unsigned long seen = 0;
+  while (true)
+  {
+    Route_Job* job;
+    {
+      unique_lock<mutex> guard(lock);
+      job_posted.wait(guard, [&]() { return stopping || (current && generation != seen); });
+      if (stopping)
+        return;
+      seen = generation;
+      job = current;
+      lock_guard<mutex> job_guard(job->lock);
+      ++job->users;
+    }
+    router.set_budget(job->budget);
+
+    Work_Range range;
+    while (job->pool.next(worker, range))
+    {
+      route_range(router, *job, range);
+      lock_guard<mutex> job_guard(job->lock);
+      job->finished[range.index] = true;
+      job->changed.notify_all();
+    }
+
+    lock_guard<mutex> job_guard(job->lock);
+    --job->users;
+    job->changed.notify_all();
+  }
+}
+
+
+bool Route_Server::route(int fd, Route_Job& job)
+{
+  const size_t nmb_ranges = job.boundaries.size() - 1;
+  job.plans.resize(job.trips.size());
+  job.finished.assign(nmb_ranges, false);
+  job.pool.distribute(job.boundaries, true);
+
+  lock_guard<mutex> submit_guard(submit_lock);
+  {
+    lock_guard<mutex> guard(lock);
+    current = &job;
+    ++generation;
+  }
+  job_posted.notify_all();
+
+  // stream plans as ranges are finished; once the client is gone, only
+  // wait for the workers
+  bool connected = true;
+  for (size_t r = 0; r < nmb_ranges; ++r)
+  {
+    {
+      unique_lock<mutex> job_guard(job.lock);
+      job.changed.wait(job_guard, [&]() { return job.finished[r]; });
+    }
+    if (!connected)
+      continue;
+
+    Message_Writer message(MSG_PLANS);
+    message.put_u32(job.boundaries[r + 1] - job.boundaries[r]);
+    for (size_t i = job.boundaries[r]; i < job.boundaries[r + 1]; ++i)
+    {
+      const Trip_Request& trip = job.trips[i];
+      list<Location>& path = job.plans[i].path;
+      message.put_u64(trip.id);
+      message.put_i64(trip.source);
+      message.put_i64(trip.destination);
+      message.put_u8(job.plans[i].budget_exceeded ? PLAN_BUDGET_EXCEEDED : PLAN_OK);
+      message.put_u32(path.size());
+      for (list<Location>::const_iterator it = path.begin(); it != path.end(); ++it)
+      {
+        message.put_i64(it->external_id);
+        message.put_f32(it->time);
+        message.put_i32(it->edge_label);
+      }
+      path.clear();
+    }
+    connected = send_message(fd, message);
+  }
+
+  // no worker may still hold the job when it is released
+  {
+    lock_guard<mutex> guard(lock);
+    current = NULL;
+  }
+  unique_lock<mutex> job_guard(job.lock);
+  job.changed.wait(job_guard, [&]() { return job.users == 0; });
+  return connected;
+}
+
+
+void Route_Server::update_costs(int fd, Message_Reader& reader)
+{
+  vector<Link_Cost> updates;
+  uint32_t nmb_links = reader.get_u32();
+  string error;
+  unsigned long epoch;
+  if (reader.ok() && reader.remaining() == (size_t)nmb_links * 24)
+  {
+    updates.resize(nmb_links);
+    for (uint32_t i = 0; i < nmb_links; ++i)
+    {
+      updates[i].tail = reader.get_i64();
+      updates[i].head = reader.get_i64();
+      updates[i].label = reader.get_i32();
+      updates[i].cost = reader.get_f32();
+    }
+    if (cost_table.update(updates, epoch, error))
+    {
+      Message_Writer done(MSG_DONE);
+      done.put_u64(epoch);
+      send_message(fd, done);
+      return;
+    }
+  }
+  else
+    error = "Malformed COSTS message.";
+
+  Message_Writer message(MSG_ERROR);
+  message.put_string(error);
+  send_message(fd, message);
+}
+
+
+void Route_Server::serve(Connection& connection)
+{
+  Routing_Context& context = *contexts[0];
+  string body;
+  while (receive_message(connection.fd, body))
+  {
+    Message_Reader reader(body);
+    if (reader.type() == MSG_SHUTDOWN)
+    {
+      closing = true;
+      ::shutdown(listen_fd, SHUT_RDWR);
+      break;
+    }
+    if (reader.type() == MSG_COSTS)
+    {
+      // runs beside the routing jobs, which pick the new costs up per query
+      update_costs(connection.fd, reader);
+      continue;
+    }
+    if (reader.type() != MSG_ROUTE)
+    {
+      Message_Writer error(MSG_ERROR);
+      error.put_string("Unknown message type " + to_string((int)reader.type()) + ".");
+      send_message(connection.fd, error);
+      break;
+    }
+
+    // limits of 0 leave those of the daemon
+    Route_Job job(nmb_workers);
+    job.budget = default_budget;
+    float max_travel_time = reader.get_f32();
+    uint64_t max_settled = reader.get_u64();
+    float max_seconds = reader.get_f32();
+    if (max_travel_time > 0)
+      job.budget.max_travel_time = max_travel_time;
+    if (max_settled > 0)
+      job.budget.max_settled = max_settled;
+    if (max_seconds > 0)
+      job.budget.max_seconds = max_seconds;
+    uint32_t nmb_trips = reader.get_u32();
+    if (reader.ok() && reader.remaining() == (size_t)nmb_trips * 32)
+    {
+      job.trips.resize(nmb_trips);
+      job.valid.resize(nmb_trips);
+      for (uint32_t i = 0; i < nmb_trips; ++i)
+      {
+        Trip_Request& trip = job.trips[i];
+        trip.id = reader.get_u64();
+        trip.source = reader.get_i64();
+        trip.destination = reader.get_i64();
+        trip.start_time = reader.get_f32();
+        uint32_t nfa = reader.get_u32();
+        trip.nfaID = nfa;
+
+        // unknown vertices or NFA get an empty plan
+        job.valid[i] = nfa < context.size() &&
+          context.network().contains(trip.source) &&
+          context.network().contains(trip.destination);
+      }
+    }
+    else
+    {
+      Message_Writer error(MSG_ERROR);
+      error.put_string("Malformed ROUTE message.");
+      send_message(connection.fd, error);
+      break;
+    }
+
+    for (size_t i = 0; i < job.trips.size(); i += batch_trips)
+      job.boundaries.push_back(i);
+    job.boundaries.push_back(job.trips.size());
+
+    if (!route(connection.fd, job))
+      break;
+    Message_Writer done(MSG_DONE);
+    done.put_u64(job.trips.size());
+    if (!send_message(connection.fd, done))
+      break;
+  }
+
+  {
+    lock_guard<mutex> guard(connections_lock);
+    close(connection.fd);
+    connection.fd = -1;
+  }
+  connection.done = true;
+}
+
+
+void Route_Server::reap_connections(bool all)
+{
+  unique_lock<mutex> guard(connections_lock);
+  for (list<Connection>::iterator it = connections.begin(); it != connections.end(); )
+  {
+    if (all && it->fd >= 0)
+      ::shutdown(it->fd, SHUT_RDWR);
+    if (all || it->done)
+    {
+      // handler may still be closing its socket, which needs the lock
+      guard.unlock();
+      it->handler.join();
+      guard.lock();
+      it = connections.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+
+void Route_Server::run()
+{
+  for (unsigned int w = 0; w < nmb_workers; ++w)
+    workers.push_back(std::thread(&Route_Server::worker_method, this, w));
+
+  while (!closing)
+  {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+      if (closing)
+        break;
+      // out of descriptors: wait for clients to close theirs
+      if (errno == EMFILE || errno == ENFILE)
+        usleep(10000);
+      continue;
+    }
+
+    reap_connections(false);
+    lock_guard<mutex> guard(connections_lock);
+    connections.emplace_back();
+    Connection& connection = connections.back();
+    connection.fd = fd;
+    connection.done = false;
+    connection.handler = std::thread(&Route_Server::serve, this, std::ref(connection));
+  }
+
+  // clients still connected are cut off after their current request
+  reap_connections(true);
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  job_posted.notify_all();
+  for (size_t w = 0; w < workers.size(); ++w)
+    workers[w].join();
+  workers.clear();
+}
+
+
+#endif
@@ -0,0 +1,374 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  Routing library: implementation of the C interface in router_api.h on
+  top of Routing_Context, Router and the batch routing of new_main.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "graph.hpp"
+#include "nfa_bundle.hpp"
+#include "nfa_compiler.hpp"
+#include "router_api.h"
+#include "routing_context.hpp"
+#include "tools.hpp"
+#include "trip_batch.hpp"
+#include "work_pool.hpp"
+
+using namespace std;
+
+Event_Handler event_handler;
+
+
+/// Routing context of the C interface.
+struct rr_context
+{
+  /// Options.
+  rr_options options;
+
+  /// Network.
+  Network_Graph* network;
+
+  /// NFA bundle, if the NFAs come from one.
+  NFA_Bundle bundle;
+
+  /// Shared routing data.
+  Routing_Context* routing;
+
+  /// Router of each worker.
+  vector<Router*> routers;
+
+  /// Trips of the last batch (IDs are positions in the batch).
+  Trip_Batch batch;
+
+  /// Plans of the distinct trips of the last batch.
+  vector<Plan> plans;
+
+  /// Flags of the trips of the last batch.
+  vector<uint8_t> flags;
+
+  /// Distinct trip of each trip of the last batch (batch.distinct.size() if
+  /// not routed).
+  vector<size_t> plan_of;
+
+  /// Number of locations of the last batch.
+  size_t nmb_locations;
+};
+
+
+/// Message of the last failed call of each thread.
+static thread_local string last_error;
+
+
+/// Set message of a failed call.
+static void set_error(const string& message)
+{
+  last_error = message;
+}
+
+
+/// Can file be read?
+static bool readable(const char* filename)
+{
+  ifstream file(filename);
+  return (bool)file;
+}
+
+
+/// Load the NFAs of an NFA collection file or NFA bundle; false with
+/// error message on error.
+static bool load_collection(rr_context* context, const char* filename, vector<NFA_Graph*>& nfas)
+{
+  if (is_nfa_bundle(filename))
+  {
+    if (!context->bundle.open(filename))
+    {
+      set_error(context->bundle.error());
+      return false;
+    }
+    for (unsigned int i = 0; i < context->bundle.nmb_nfas(); ++i)
+      nfas.push_back(context->bundle.nfa(i));
+    return true;
+  }
+
+  vector<string> entries;
+  if (!read_nfa_collection(filename, entries))
+  {
+    set_error("could not open the NFA collection " + string(filename) + ".");
+    return false;
+  }
+  string error;
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    NFA_Graph* nfa = load_nfa(entries[i], *context->network, error);
+    if (nfa == NULL)
+    {
+      for (size_t j = 0; j < nfas.size(); ++j)
+	delete nfas[j];
+      nfas.clear();
+      set_error(error);
+      return false;
+    }
+    nfas.push_back(nfa);
+  }
+  return true;
+}
+
+
+/// Route the bundles of the ranges taken from pool by worker.
+static void route_ranges(rr_context* context, unsigned int worker, Work_Pool& pool)
+{
+  Router& router = *context->routers[worker];
+  const Trip_Batch& batch = context->batch;
+  vector<Trip_Request> bundle_trips;
+  vector<Plan> bundle_plans;
+  Work_Range range;
+  while (pool.next(worker, range))
+    for (size_t b = range.begin; b < range.end; ++b)
+    {
+      route_bundle(router, context->options.algorithm, batch, b, bundle_trips, bundle_plans);
+      for (size_t i = 0; i < bundle_trips.size(); ++i)
+      {
+	Plan& plan = context->plans[batch.bundles[b][i]];
+	plan.path.swap(bundle_plans[i].path);
+	plan.budget_exceeded = bundle_plans[i].budget_exceeded;
+      }
+    }
+}
+
+
+
+extern "C" {
+
+
+int rr_api_version(void)
+{
+  return RR_API_VERSION;
+}
+
+
+void rr_default_options(rr_options* options)
+{
+  options->algorithm = STD;
+  options->threads = 0;
+  options->batch_trips = 64;
+  options->max_travel_time = 0;
+  options->max_settled = 0;
+  options->max_seconds = 0;
+}
+
+
+rr_context* rr_load(const char* links, const char* nodes, const char* nfas,
+		    const rr_options* options)
+{
+  rr_options defaults;
+  rr_default_options(&defaults);
+  if (options == NULL)
+    options = &defaults;
+  if (links == NULL || nodes == NULL || nfas == NULL)
+  {
+    set_error("missing network or NFA file name.");
+    return NULL;
+  }
+  if (options->algorithm < STD || options->algorithm > GOBI)
+  {
+    set_error("invalid algorithm " + itos(options->algorithm) + ".");
+    return NULL;
+  }
+  if (!readable(links) || !readable(nodes))
+  {
+    set_error("could not open the network files " + string(links) + " and " + string(nodes) + ".");
+    return NULL;
+  }
+
+  rr_context* context = new rr_context();
+  context->options = *options;
+  if (context->options.threads == 0)
+    context->options.threads = max(std::thread::hardware_concurrency(), 1u);
+  if (context->options.batch_trips == 0)
+    context->options.batch_trips = 64;
+  context->network = new Network_Graph(links, nodes);
+  vector<NFA_Graph*> nfa_vector;
+  if (!load_collection(context, nfas, nfa_vector))
+  {
+    delete context->network;
+    delete context;
+    return NULL;
+  }
+
+  bool backward = options->algorithm == BI || options->algorithm == GOBI;
+  context->routing = new Routing_Context(*context->network, nfa_vector, backward);
+  Search_Budget budget;
+  budget.max_travel_time = options->max_travel_time;
+  budget.max_settled = options->max_settled;
+  budget.max_seconds = options->max_seconds;
+  for (unsigned int w = 0; w < context->options.threads; ++w)
+  {
+    context->routers.push_back(new Router(*context->routing));
+    context->routers.back()->set_budget(budget);
+  }
+  context->nmb_locations = 0;
+  return context;
+}
+
+
+void rr_free(rr_context* context)
+{
+  if (context == NULL)
+    return;
+  for (size_t w = 0; w < context->routers.size(); ++w)
+    delete context->routers[w];
+  delete context->routing;
+  delete context->network;
+  delete context;
+}
+
+
+const char* rr_last_error(void)
+{
+  return last_error.c_str();
+}
+
+
+size_t rr_nmb_nfas(const rr_context* context)
+{
+  return context ? context->routing->size() : 0;
+}
+
+
+int rr_route(rr_context* context, size_t n, const int64_t* sources,
+	     const int64_t* destinations, const float* start_times,
+	     const int32_t* nfa_ids, size_t* nmb_locations)
+{
+  if (context == NULL)
+  {
+    set_error("no routing context.");
+    return RR_INVALID_ARGUMENT;
+  }
+  if (n > 0 && (sources == NULL || destinations == NULL || start_times == NULL || nfa_ids == NULL))
+  {
+    set_error("missing trip array.");
+    return RR_INVALID_ARGUMENT;
+  }
+  Trip_Batch& batch = context->batch;
+  batch = Trip_Batch();
+  context->flags.assign(n, 0);
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (!context->network->contains(sources[i]) || !context->network->contains(destinations[i]))
+      context->flags[i] = RR_UNKNOWN_VERTEX;
+    else if (nfa_ids[i] < 0 || (size_t)nfa_ids[i] >= context->routing->size())
+      context->flags[i] = RR_UNKNOWN_NFA;
+    else
+    {
+      Trip_Request trip;
+      trip.id = i;
+      trip.source = sources[i];
+      trip.destination = destinations[i];
+      trip.start_time = start_times[i];
+      trip.nfaID = nfa_ids[i];
+      batch.trips.push_back(trip);
+    }
+  }
+
+  // duplicates are routed once, bundles of a source in one search
+  prepare_trips(batch);
+  context->plans.assign(batch.distinct.size(), Plan());
+  vector<size_t> boundaries;
+  split_bundles(batch, context->options.batch_trips, boundaries);
+  unsigned int nmb_workers = min((size_t)context->options.threads, boundaries.size() - 1);
+  Work_Pool pool(max(nmb_workers, 1u));
+  pool.distribute(boundaries);
+  if (nmb_workers <= 1)
+    route_ranges(context, 0, pool);
+  else
+  {
+    vector<std::thread> threads;
+    for (unsigned int w = 0; w < nmb_workers; ++w)
+      threads.push_back(std::thread(route_ranges, context, w, std::ref(pool)));
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  context->plan_of.assign(n, batch.distinct.size());
+  context->nmb_locations = 0;
+  for (size_t t = 0; t < batch.trips.size(); ++t)
+  {
+    size_t i = batch.trips[t].id;
+    const Plan& plan = context->plans[batch.copy_of[t]];
+    context->plan_of[i] = batch.copy_of[t];
+    context->flags[i] = plan.budget_exceeded ? RR_BUDGET_EXCEEDED
+      : plan.path.empty() ? 0 : RR_PLAN_FOUND;
+    context->nmb_locations += plan.path.size();
+  }
+  if (nmb_locations)
+    *nmb_locations = context->nmb_locations;
+  return RR_OK;
+}
+
+
+int rr_plans(const rr_context* context, uint64_t* offsets, int64_t* vertices,
+	     float* times, int32_t* labels, uint8_t* flags, size_t capacity)
+{
+  if (context == NULL)
+  {
+    set_error("no routing context.");
+    return RR_INVALID_ARGUMENT;
+  }
+  if (offsets == NULL || flags == NULL ||
+      (capacity > 0 && (vertices == NULL || times == NULL || labels == NULL)))
+  {
+    set_error("missing plan array.");
+    return RR_INVALID_ARGUMENT;
+  }
+  const size_t n = context->flags.size();
+  const bool copy = capacity >= context->nmb_locations;
+  uint64_t position = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    offsets[i] = position;
+    flags[i] = context->flags[i];
+    if (context->plan_of[i] == context->plans.size())
+      continue;
+    const Plan& plan = context->plans[context->plan_of[i]];
+    for (list<Location>::const_iterator it = plan.path.begin(); it != plan.path.end(); ++it, ++position)
+      if (copy)
+      {
+	vertices[position] = it->external_id;
+	times[position] = it->time;
+	labels[position] = it->edge_label;
+      }
+  }
+  offsets[n] = position;
+  if (!copy)
+  {
+    set_error("buffer for " + itos(capacity) + " locations, " + itos(context->nmb_locations) + " needed.");
+    return RR_BUFFER_TOO_SMALL;
+  }
+  return RR_OK;
+}
+
+
+int rr_route_batch(rr_context* context, size_t n, const int64_t* sources,
+		   const int64_t* destinations, const float* start_times,
+		   const int32_t* nfa_ids, uint64_t* offsets,
+		   int64_t* vertices, float* times, int32_t* labels,
+		   uint8_t* flags, size_t capacity, size_t* nmb_locations)
+{
+  int status = rr_route(context, n, sources, destinations, start_times, nfa_ids, nmb_locations);
+  if (status != RR_OK)
+    return status;
+  return rr_plans(context, offsets, vertices, times, labels, flags, capacity);
+}
+
+
+}
@@ -0,0 +1,123 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  C interface of the routing library (librouter.so): load a network and
+  an NFA collection once, then route batches of trips given as arrays and
+  receive their plans in arrays provided by the caller.  Plain C types
+  only, so that the library can be bound from other languages (e.g. with
+  Python ctypes) without copying the arrays.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef ROUTER_API_H
+#define ROUTER_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define RR_API __attribute__((visibility("default")))
+#else
+#define RR_API
+#endif
+
+/* Version of this interface; changed on incompatible changes only. */
+#define RR_API_VERSION 1
+
+/* Status of calls. */
+#define RR_OK 0
+#define RR_ERROR -1
+#define RR_BUFFER_TOO_SMALL -2
+#define RR_INVALID_ARGUMENT -3  /* NULL context or array */
+
+/* Flags of a routed trip. */
+#define RR_PLAN_FOUND 1        /* plan with at least one location */
+#define RR_BUDGET_EXCEEDED 2   /* search aborted by its budget, no plan */
+#define RR_UNKNOWN_VERTEX 4    /* source or destination not in the network */
+#define RR_UNKNOWN_NFA 8       /* NFA ID not in the collection */
+
+/* Routing context: network, NFAs and routers; opaque. */
+typedef struct rr_context rr_context;
+
+/* Options of a routing context. */
+typedef struct rr_options
+{
+  /* 0: standard, 1: goal-directed, 2: bidirectional, 3: bidirectional,
+     goal-directed Dijkstra */
+  int algorithm;
+
+  /* Worker threads of rr_route (0: one per hardware thread). */
+  unsigned int threads;
+
+  /* Distinct trips per work range. */
+  size_t batch_trips;
+
+  /* Search limits (0: none), see new_main --max-time etc. */
+  float max_travel_time;
+  unsigned long max_settled;
+  double max_seconds;
+} rr_options;
+
+/* Get RR_API_VERSION of the library. */
+RR_API int rr_api_version(void);
+
+/* Set default options. */
+RR_API void rr_default_options(rr_options* options);
+
+/* Load network (links and nodes files) and NFAs (NFA collection file or
+   NFA bundle) with options (NULL: defaults).  Returns NULL on error, see
+   rr_last_error; errors in NFA files or expressions do not end the
+   process. */
+RR_API rr_context* rr_load(const char* links, const char* nodes,
+			   const char* nfas, const rr_options* options);
+
+/* Release context. */
+RR_API void rr_free(rr_context* context);
+
+/* Get message of the last failed call of this thread. */
+RR_API const char* rr_last_error(void);
+
+/* Get number of NFAs of context (0 without context). */
+RR_API size_t rr_nmb_nfas(const rr_context* context);
+
+/* Route n trips: source and destination vertices (external IDs), start
+   times and NFA IDs.  Plans are kept in the context until the next call;
+   nmb_locations (may be NULL) receives their total number of locations.
+   A context routes one batch at a time.  RR_INVALID_ARGUMENT without
+   context or with a NULL array (n > 0). */
+RR_API int rr_route(rr_context* context, size_t n, const int64_t* sources,
+		    const int64_t* destinations, const float* start_times,
+		    const int32_t* nfa_ids, size_t* nmb_locations);
+
+/* Copy the plans of the last rr_route: the locations of trip i are
+   offsets[i]..offsets[i+1] of vertices, times and labels (label of the
+   link travelled to the location), flags[i] the RR_* flags of trip i.
+   offsets has n+1 entries, flags n.  Locations are only copied if
+   capacity is at least their number; RR_BUFFER_TOO_SMALL otherwise
+   (offsets and flags are set nonetheless).  RR_INVALID_ARGUMENT without
+   context, offsets or flags, or with a NULL location array and a
+   capacity above 0. */
+RR_API int rr_plans(const rr_context* context, uint64_t* offsets,
+		    int64_t* vertices, float* times, int32_t* labels,
+		    uint8_t* flags, size_t capacity);
+
+/* rr_route and rr_plans in one call.  On RR_BUFFER_TOO_SMALL, call
+   rr_plans with nmb_locations locations; trips are not routed again. */
+RR_API int rr_route_batch(rr_context* context, size_t n, const int64_t* sources,
+			  const int64_t* destinations, const float* start_times,
+			  const int32_t* nfa_ids, uint64_t* offsets,
+			  int64_t* vertices, float* times, int32_t* labels,
+			  uint8_t* flags, size_t capacity, size_t* nmb_locations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,150 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef ROUTING_CONTEXT_HPP
+#define ROUTING_CONTEXT_HPP
+
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "edge_costs.hpp"
+#include "graph.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Routing data shared by all routers of a run.
+/// Holds the network, the NFAs, the disjoint union of the NFAs for joint
+/// searches, optionally the backward graphs for bidirectional searches, and
+/// the speed bounds of the goal-directed engines.  The context is built once
+/// and only read afterwards, so routers in any number of threads can search
+/// it concurrently; they only keep their own search workspaces.
+class Routing_Context
+{
+protected:
+  /// Network graph.
+  Network_Graph& network_graph;
+
+  /// NFAs (owned).
+  vector<NFA_Graph*> nfa_vector;
+
+  /// Disjoint union of all NFAs.
+  NFA_Graph union_nfa;
+
+  /// NFA index of each union state.
+  vector<unsigned int> union_tag;
+
+  /// Start state of each NFA within the union.
+  vector<NFA_Vertex*> union_start;
+
+  /// Backward network (NULL without backward graphs).
+  Back_Network* back_net;
+
+  /// Backward NFAs.
+  vector<Back_NFA*> back_nfas;
+
+  /// Maximum speed for Goal_Dijkstra.
+  float goal_speed;
+
+  /// Maximum edge length for Bi_Goal_Dijkstra.
+  float bi_goal_speed;
+
+  /// Replaceable edge costs (NULL: costs of the network).
+  Cost_Table* cost_table;
+
+
+public:
+  /// Constructor; takes ownership of the NFAs.
+  /// \param backward  build backward graphs for bidirectional search
+  Routing_Context(Network_Graph& network, const vector<NFA_Graph*>& nfas,
+		  bool backward = false);
+
+  /// Destructor.
+  ~Routing_Context();
+
+  /// Get network.
+  Network_Graph& network() const { return network_graph; }
+
+  /// Get number of NFAs.
+  unsigned int size() const { return nfa_vector.size(); }
+
+  /// Get NFA.
+  NFA_Graph& nfa(unsigned int i) const { return *nfa_vector[i]; }
+
+  /// Get union of all NFAs.
+  NFA_Graph& nfa_union() { return union_nfa; }
+
+  /// Get NFA index of each union state.
+  const vector<unsigned int>& nfa_tag() const { return union_tag; }
+
+  /// Get start state of each NFA within the union.
+  const vector<NFA_Vertex*>& nfa_start() const { return union_start; }
+
+  /// Are there backward graphs?
+  bool backward() const { return back_net != NULL; }
+
+  /// Get backward network.
+  Back_Network& back_network() const { return *back_net; }
+
+  /// Get backward NFA.
+  Back_NFA& back_nfa(unsigned int i) const { return *back_nfas[i]; }
+
+  /// Get maximum speed for Goal_Dijkstra.
+  float max_speed() const { return goal_speed; }
+
+  /// Get maximum edge length for Bi_Goal_Dijkstra.
+  float max_length() const { return bi_goal_speed; }
+
+  /// Route on the current epoch of a cost table (not owned; may be shared
+  /// by replicas of the network, whose edge IDs agree).
+  void set_cost_table(Cost_Table* table) { cost_table = table; }
+
+  /// Get current edge costs (NULL without cost table).
+  shared_ptr<const Edge_Costs> costs() const
+  {
+    return cost_table ? cost_table->get() : shared_ptr<const Edge_Costs>();
+  }
+};
+
+
+Routing_Context::Routing_Context(Network_Graph& network,
+				 const vector<NFA_Graph*>& nfas, bool backward):
+  network_graph(network), nfa_vector(nfas), union_nfa(), union_tag(),
+  union_start(), back_net(NULL), back_nfas(),
+  goal_speed(max_network_speed(network)), bi_goal_speed(max_edge_length(network)),
+  cost_table(NULL)
+{
+  for (unsigned int i = 0; i < nfa_vector.size(); ++i)
+  {
+    union_start.push_back(union_nfa.add_disjoint(*nfa_vector[i]));
+    union_tag.resize(union_nfa.size(), i);
+  }
+  union_nfa.set_edge_pointers();
+
+  if (backward)
+  {
+    back_net = new Back_Network(network);
+    for (unsigned int i = 0; i < nfa_vector.size(); ++i)
+      back_nfas.push_back(new Back_NFA(*nfa_vector[i]));
+  }
+}
+
+
+Routing_Context::~Routing_Context()
+{
+  delete back_net;
+  for (unsigned int i = 0; i < back_nfas.size(); ++i)
+    delete back_nfas[i];
+  for (unsigned int i = 0; i < nfa_vector.size(); ++i)
+    delete nfa_vector[i];
+}
+
+
+#endif
@@ -0,0 +1,152 @@
+#include "../dijkstra.hpp"
+#include "../nfa_compiler.hpp"
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+Event_Handler event_handler;
+
+/// Does the automaton accept the label word?
+bool accepts(NFA_Graph& nfa, const vector<Label>& word){
+  list<NFA_Vertex*> current = nfa.start();
+  for(size_t i = 0; i < word.size(); ++i){
+    list<NFA_Vertex*> next;
+    for(list<NFA_Vertex*>::iterator it = current.begin(); it != current.end(); ++it)
+      for(NFA_Vertex::Edge_It e = (*it)->out_edge_begin(word[i]);
+	  e != (*it)->out_edge_end(word[i]); ++e)
+	next.push_back((*e)->head());
+    current = next;
+  }
+  for(list<NFA_Vertex*>::iterator it = current.begin(); it != current.end(); ++it)
+    if((*it)->accepting())
+      return true;
+  return false;
+}
+
+vector<Label> word(const char* letters){
+  vector<Label> w;
+  for(; *letters; ++letters)
+    w.push_back(*letters == 'a' ? 0 : 3);
+  return w;
+}
+
+int check(NFA_Graph& nfa, const char* letters, bool expected){
+  if(accepts(nfa, word(letters)) != expected){
+    cout << "\tWrong answer for <" << letters << ">" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+int test1(Network_Graph& network, const char* filename = "nfaDead.txt"){
+  cout << "Test1 [pruning]: file <" << filename << ">:" << endl;
+
+  NFA_Graph nfa(filename, network);
+  int fails = (nfa.size() != 3);
+  fails += check(nfa, "wa", true);
+  fails += check(nfa, "waaa", true);
+  fails += check(nfa, "w", true);
+  fails += check(nfa, "waw", false);
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails ? 1 : 0;
+}
+
+int test2(bool determinise, const char* regex = "w*(a)*w*"){
+  cout << "Test2 [compile, determinise=" << determinise << "]: <" << regex << ">:" << endl;
+
+  NFA_Graph* nfa = nfa_compiler.compile(regex, determinise);
+  int fails = (nfa->size() != 3 || nfa->start().size() != 1);
+  fails += check(*nfa, "", true);
+  fails += check(*nfa, "wwaaw", true);
+  fails += check(*nfa, "aw", true);
+  fails += check(*nfa, "awa", false);
+  fails += check(*nfa, "wawaw", false);
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails ? 1 : 0;
+}
+
+int test3(const char* regex = "(a|w)+ 3?"){
+  cout << "Test3 [cache]: <" << regex << ">:" << endl;
+
+  NFA_Graph* nfa = nfa_compiler.compiled(regex);
+  int fails = (nfa != nfa_compiler.compiled(regex));
+  fails += check(*nfa, "", false);
+  fails += check(*nfa, "aw", true);
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails ? 1 : 0;
+}
+
+int test4(){
+  cout << "Test4 [syntax errors]:" << endl;
+
+  const char* regexes[4] = { "a(", "a)", "(w|x)", "w*(" };
+  int fails = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    string error;
+    fails += (nfa_compiler.compiled(regexes[i], true, true, &error) != NULL || error.empty());
+  }
+  // the compiler recovers for the next expression
+  string error;
+  fails += (nfa_compiler.compile("w*", true, true, &error) == NULL || !error.empty());
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails ? 1 : 0;
+}
+
+int test5(){
+  cout << "Test5 [threads]:" << endl;
+
+  // valid and invalid expressions compiled at once by several threads
+  const char* regexes[4] = { "w*(a)*w*", "(a|w", "a+w?", "w)" };
+  vector<int> thread_fails(4, 0);
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.push_back(std::thread([&, t](){
+      for (int i = 0; i < 200; ++i)
+      {
+        const char* regex = regexes[(t + i) % 4];
+        bool valid = ((t + i) % 2 == 0);
+        string error;
+        NFA_Graph* nfa = nfa_compiler.compile(regex, true, true, &error);
+        thread_fails[t] += (valid != (nfa != NULL) || valid != error.empty());
+        if (nfa != NULL)
+          thread_fails[t] += !accepts(*nfa, vector<Label>(1, 0));
+        delete nfa;
+      }
+    }));
+  int fails = 0;
+  for (int t = 0; t < 4; ++t)
+  {
+    threads[t].join();
+    fails += thread_fails[t];
+  }
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails ? 1 : 0;
+}
+
+int main(int argc, const char* argv[]){
+  if( argc < 3 ){
+    cout << "Missing argument(s): <links file> <nodes file>" << endl;
+    return 1;
+  }
+
+  Network_Graph network(argv[1], argv[2]);
+
+  unsigned int numFails = 0;
+  numFails += test1(network);
+  numFails += test2(true);
+  numFails += test2(false);
+  numFails += test3();
+  numFails += test4();
+  numFails += test5();
+
+  if( numFails > 0 ){
+    cout << "One or more tests failed" << endl;
+    return 1;
+  }
+  else {
+    cout << "All tests passed" << endl;
+    return 0;
+  }
+}
@@ -0,0 +1,81 @@
+#include "../plan_text.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+
+/// Does a time format like ostream <<?
+int check_time(float time){
+  ostringstream expected;
+  expected << time << '\t';
+  string text;
+  append_time(text, time);
+  if(text != expected.str()){
+    cout << "\tWrong text <" << text << "> for <" << expected.str() << ">" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+int test1(){
+  cout << "Test1 [times]:" << endl;
+
+  float special[] = { 0, -0.0f, 1, 0.5f, 1e-5f, 1e-4f, 123456, 1234567, 1e6f, 999999.5f,
+		      86399.999f, 3600.0001f, -17.25f, numeric_limits<float>::max(),
+		      numeric_limits<float>::min(), numeric_limits<float>::denorm_min() };
+  int fails = 0;
+  for(size_t i = 0; i < sizeof(special) / sizeof(special[0]); ++i)
+    fails += check_time(special[i]);
+
+  // times of a day with several fractional resolutions
+  srand(1);
+  for(int i = 0; i < 200000; ++i){
+    float time = (float)rand() / RAND_MAX * 200000;
+    if(i % 3 == 1)
+      time = (int)(time * 1000) / 1000.0f;
+    fails += check_time(time);
+  }
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails ? 1 : 0;
+}
+
+int test2(){
+  cout << "Test2 [plan lines]:" << endl;
+
+  ostringstream expected;
+  expected << 18446744073709551615UL << '\t' << -42L << '\t' << 7L << '\t' << 3u << '\t'
+	   << -42L << '\t' << 28800.0f << '\t'
+	   << 5L << '\t' << 28812.5f << '\t' << 0 << '\t'
+	   << 7L << '\t' << 28830.125f << '\t' << -1 << '\t' << '\n'
+	   << 2UL << '\t' << 1L << '\t' << 2L << '\t' << 0u << '\t' << "budget_exceeded\t" << '\n';
+
+  string text;
+  append_plan_head(text, 18446744073709551615UL, -42, 7, 3, false);
+  append_location(text, -42, 28800.0f, 3, true);
+  append_location(text, 5, 28812.5f, 0, false);
+  append_location(text, 7, 28830.125f, -1, false);
+  text += '\n';
+  append_plan_head(text, 2, 1, 2, 0, true);
+  text += '\n';
+
+  int fails = (text != expected.str());
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails;
+}
+
+int main(){
+  unsigned int numFails = 0;
+  numFails += test1();
+  numFails += test2();
+
+  if( numFails > 0 ){
+    cout << "One or more tests failed" << endl;
+    return 1;
+  }
+  else {
+    cout << "All tests passed" << endl;
+    return 0;
+  }
+}
@@ -0,0 +1,109 @@
+#include "../router_api.h"
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+const char* LINKS = "../../example/network-links.txt";
+const char* NODES = "../../example/network-nodes.txt";
+const char* NFAS = "nfaCollection.txt";
+
+/// Plans are the same with one and with two threads, and a small buffer
+/// gets RR_BUFFER_TOO_SMALL without losing the plans.
+int test1(){
+  cout << "Test 1: threads and buffer sizes";
+  vector<int64_t> sources = { 2, 7, 10, 10, 10 };
+  vector<int64_t> destinations = { 4, 2, 2, 1, 8 };
+  vector<float> start_times(5, 10);
+  vector<int32_t> nfa_ids(5, 0);
+  vector<vector<int64_t> > vertices(2);
+  vector<vector<uint64_t> > offsets(2, vector<uint64_t>(6));
+  int fails = 0;
+  for (unsigned int t = 0; t < 2; ++t)
+  {
+    rr_options options;
+    rr_default_options(&options);
+    options.threads = t + 1;
+    options.batch_trips = 1;
+    rr_context* context = rr_load(LINKS, NODES, NFAS, &options);
+    if (context == NULL){
+      cout << "\tFail" << endl;
+      return 1;
+    }
+    vector<uint8_t> flags(5);
+    size_t nmb_locations = 0;
+    int status = rr_route_batch(context, 5, sources.data(), destinations.data(),
+				start_times.data(), nfa_ids.data(), offsets[t].data(),
+				NULL, NULL, NULL, flags.data(), 0, &nmb_locations);
+    fails += (status != RR_BUFFER_TOO_SMALL || nmb_locations == 0 ||
+	      offsets[t][5] != nmb_locations);
+    vertices[t].resize(nmb_locations);
+    vector<float> times(nmb_locations);
+    vector<int32_t> labels(nmb_locations);
+    status = rr_plans(context, offsets[t].data(), vertices[t].data(), times.data(),
+		      labels.data(), flags.data(), nmb_locations);
+    fails += (status != RR_OK);
+    for (size_t i = 0; i < 5; ++i)
+      fails += (flags[i] != RR_PLAN_FOUND || vertices[t][offsets[t][i]] != sources[i]
+		|| vertices[t][offsets[t][i + 1] - 1] != destinations[i]);
+    rr_free(context);
+  }
+  fails += (vertices[0] != vertices[1] || offsets[0] != offsets[1]);
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails > 0;
+}
+
+/// Trips with unknown vertices or NFAs are flagged; missing files, bad NFA
+/// expressions and missing arrays are reported.
+int test2(){
+  cout << "Test 2: unknown vertices, NFAs, files and arguments";
+  int fails = (rr_load("missing-links.txt", NODES, NFAS, NULL) != NULL
+	       || rr_last_error()[0] == 0);
+  fails += (rr_load(LINKS, NODES, "nfaBadCollection.txt", NULL) != NULL
+	    || rr_last_error()[0] == 0);
+  rr_context* context = rr_load(LINKS, NODES, NFAS, NULL);
+  if (context == NULL){
+    cout << "\tFail" << endl;
+    return 1;
+  }
+  int64_t sources[3] = { 2, -5, 2 };
+  int64_t destinations[3] = { 4, 4, 4 };
+  float start_times[3] = { 10, 10, 10 };
+  int32_t nfa_ids[3] = { 0, 0, (int32_t)rr_nmb_nfas(context) };
+  size_t nmb_locations = 0;
+  fails += (rr_route(context, 3, sources, destinations, start_times, nfa_ids,
+		     &nmb_locations) != RR_OK);
+  uint64_t offsets[4];
+  uint8_t flags[3];
+  vector<int64_t> vertices(nmb_locations);
+  vector<float> times(nmb_locations);
+  vector<int32_t> labels(nmb_locations);
+  fails += (rr_plans(context, offsets, vertices.data(), times.data(), labels.data(),
+		     flags, nmb_locations) != RR_OK);
+  fails += (flags[0] != RR_PLAN_FOUND || flags[1] != RR_UNKNOWN_VERTEX
+	    || flags[2] != RR_UNKNOWN_NFA || offsets[1] != nmb_locations
+	    || offsets[3] != nmb_locations);
+  fails += (rr_route(context, 3, NULL, destinations, start_times, nfa_ids, NULL) != RR_INVALID_ARGUMENT);
+  fails += (rr_route(NULL, 3, sources, destinations, start_times, nfa_ids, NULL) != RR_INVALID_ARGUMENT);
+  fails += (rr_plans(context, NULL, vertices.data(), times.data(), labels.data(), flags,
+		     nmb_locations) != RR_INVALID_ARGUMENT);
+  fails += (rr_plans(context, offsets, NULL, NULL, NULL, flags, 1) != RR_INVALID_ARGUMENT);
+  rr_free(context);
+  cout << (fails ? "\tFail" : "\tSuccess") << endl;
+  return fails > 0;
+}
+
+int main(){
+  unsigned int numFails = 0;
+  numFails += test1();
+  numFails += test2();
+
+  if( numFails > 0 ){
+    cout << "One or more tests failed" << endl;
+    return 1;
+  }
+  else {
+    cout << "All tests passed" << endl;
+    return 0;
+  }
+}
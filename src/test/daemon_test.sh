@@ -0,0 +1,63 @@
+#!/bin/bash
+# Swap the link costs of a routing daemon (new_main --serve) and check that
+# the goal-directed engines (-a 1 and -a 3) still find shortest paths: the
+# arrival time of every trip must equal that of plain Dijkstra (-a 0) run
+# in batch mode on a network file with the new costs.
+# Usage: ./daemon_test.sh (from src/test, after building src)
+
+example=../../example
+work=$(mktemp -d)
+socket=$work/router.sock
+trap 'rm -rf $work' EXIT
+
+# every link cost divided by 10
+awk 'NR == 1 { print; next } { $7 = sprintf("%.2f", $7 / 10); print }' \
+    $example/network-links.txt > $work/links.txt
+
+# arrival time of each trip: id, then time of the last location (- if none)
+arrivals() {
+    awk '{ print $1, ($4 > 0 ? $(3 + 3 * $4) : "-") }' $1 | sort -n > $2
+}
+
+cd $example
+../src/new_main -g $work/links.txt -c network-nodes.txt -N nfa_main.txt \
+    -f test-trip-file.txt -a 0 -s 2 -o $work/expected.txt > /dev/null
+cd - > /dev/null
+arrivals $work/expected.txt $work/expected-arrivals.txt
+
+fails=0
+for algorithm in 1 3; do
+    echo -n "Algorithm $algorithm: swapped costs"
+    (cd $example && exec ../src/new_main -g network-links.txt -c network-nodes.txt \
+        -N nfa_main.txt -a $algorithm -s 2 --serve $socket > $work/daemon.log 2>&1) &
+    daemon=$!
+    for i in $(seq 50); do
+        [ -S $socket ] && break
+        sleep 0.1
+    done
+    ../route_client $socket --costs $work/links.txt > /dev/null &&
+        ../route_client $socket $example/test-trip-file.txt $work/plans.txt > /dev/null
+    routed=$?
+    ../route_client $socket --shutdown > /dev/null
+    wait $daemon
+    stopped=$?
+    arrivals $work/plans.txt $work/arrivals.txt
+    if [ $routed -ne 0 ] || [ $stopped -ne 0 ] ||
+       ! awk 'NR == FNR { time[$1] = $2; next }
+              !($1 in time) || ($2 == "-") != (time[$1] == "-") ||
+              ($2 != "-" && ($2 - time[$1] > 0.001 || time[$1] - $2 > 0.001)) { exit 1 }
+              END { if (FNR != length(time)) exit 1 }' \
+            $work/expected-arrivals.txt $work/arrivals.txt; then
+        echo -e "\tFail"
+        fails=$((fails + 1))
+    else
+        echo -e "\tSuccess"
+    fi
+    rm -f $socket $work/plans.txt
+done
+
+if [ $fails -gt 0 ]; then
+    echo "One or more tests failed"
+    exit 1
+fi
+echo "All tests passed"
@@ -1,12 +1,16 @@
 #ifndef TOOLS_HPP
 #define TOOLS_HPP
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <fstream>
+#include <tuple>
 
 #include "dijkstra.hpp"
 #include "graph.hpp"
+#include "plan_cache.hpp"
+#include "routing_context.hpp"
 #include "timer.hpp"
 
 #include <log4cplus/layout.h>
@@ -166,40 +170,323 @@ public:
 class Router
 {
 protected:
-    /// Network graph.
-    Network_Graph &network;
-
-    /// NFA graph.
-    vector<NFA_Graph *> &nfaVector;
+    /// Shared routing data.
+    Routing_Context &context;
 
-    /// Routing engines.
+    /// Routing engines per NFA and algorithm, created on first use.
     vector<vector<Shortest_Path *> > dijkstra;
 
-public:
-    /// Constructor.
-    Router(Network_Graph &n1, vector<NFA_Graph *> &nfaVec) : network(n1), nfaVector(nfaVec)
-    {
-        const unsigned int nNFA = nfaVec.size();
+    /// Joint routing engine.
+    Multi_NFA_Dijkstra *multi_dijkstra;
+
+    /// Shared plan cache (NULL if disabled).
+    Plan_Cache *plan_cache;
 
-        dijkstra = vector<vector<Shortest_Path *> >(nNFA);
+    /// Limits of each search.
+    Search_Budget budget;
 
-        for (unsigned int i = 0; i < nNFA; ++i)
+    /// Drop plan whose travel time exceeds the budget (goal-directed
+    /// searches only bound it from below; cached plans may predate it).
+    void check_budget(Plan &plan) const
+    {
+        if (budget.max_travel_time > 0 && !plan.path.empty() &&
+            plan.path.back().time - plan.path.front().time > budget.max_travel_time)
         {
-            dijkstra[i].resize(4);
+            plan.path.clear();
+            plan.budget_exceeded = true;
+        }
+    }
 
-            dijkstra[i][STD] = new Shortest_Path(network, *nfaVector[i]);
+    /// Get routing engine.
+    Shortest_Path *engine(Algorithm algorithm, unsigned int i)
+    {
+        assert(i < dijkstra.size());
+        Shortest_Path *&engine = dijkstra[i][algorithm];
+        if (engine == NULL)
+        {
+            Network_Graph &network = context.network();
+            NFA_Graph &nfa = context.nfa(i);
+            assert(context.backward() || algorithm == STD || algorithm == GO);
+            switch (algorithm)
+            {
+            case STD:
+                engine = new Shortest_Path(network, nfa);
+                break;
+            case GO:
+                engine = new Goal_Dijkstra(network, nfa, context.max_speed());
+                break;
+            case BI:
+                engine = new Bi_Dijkstra(network, nfa, context.back_network(),
+                                         context.back_nfa(i));
+                break;
+            case GOBI:
+                engine = new Bi_Goal_Dijkstra(network, nfa, context.back_network(),
+                                              context.back_nfa(i), context.max_length());
+                break;
+            }
         }
+        return engine;
+    }
+
+public:
+    /// Constructor.
+    /// Routers only hold search workspaces; any number of them may share
+    /// one context.
+    Router(Routing_Context &c) : context(c),
+        dijkstra(c.size(), vector<Shortest_Path *>(4, (Shortest_Path *)NULL)),
+        multi_dijkstra(new Multi_NFA_Dijkstra(c.network(), c.nfa_union(),
+                                              c.nfa_tag(), c.nfa_start())),
+        plan_cache(NULL), budget()
+    {
+    }
+
+    /// Destructor.
+    ~Router()
+    {
+        for (unsigned int i = 0; i < dijkstra.size(); ++i)
+            for (unsigned int j = 0; j < dijkstra[i].size(); ++j)
+                delete dijkstra[i][j];
+        delete multi_dijkstra;
     }
 
+    /// Use plan cache shared with other routers.
+    void set_cache(Plan_Cache *cache) { plan_cache = cache; }
+
+    /// Limit each search; a search hitting a limit yields a plan marked
+    /// budget_exceeded.  Joint searches of bundles are limited as a whole.
+    void set_budget(const Search_Budget &b) { budget = b; }
+
     /// Compute route with specified routing algorithm.
     void find_path(Algorithm algorithm, Trip_Request trip, Plan &plan,
                    double &time_elapsed, unsigned int nfaChoice = 0)
     {
-        dijkstra[nfaChoice][algorithm]->init(trip);
+        // the query runs on the costs current at its start to its end
+        shared_ptr<const Edge_Costs> costs = context.costs();
+        unsigned long epoch = costs ? costs->epoch : 0;
+        plan.budget_exceeded = false;
+        if (plan_cache && plan_cache->lookup(trip, plan, epoch))
+        {
+            check_budget(plan);
+            time_elapsed = 0;
+            return;
+        }
+        Shortest_Path *dijkstra = engine(algorithm, nfaChoice);
+        dijkstra->set_costs(costs.get());
+        dijkstra->set_budget(budget);
+        dijkstra->init(trip);
+        Timer timer;
+        dijkstra->dijkstra();
+        time_elapsed = timer.elapsed();
+        if (dijkstra->budget_exceeded())
+            plan.budget_exceeded = true;
+        else
+            dijkstra->reconstruct_path(plan);
+        dijkstra->set_costs(NULL);
+        check_budget(plan);
+        // plans cut off by a budget depend on it and are not cached
+        if (plan_cache && !plan.budget_exceeded)
+            plan_cache->insert(trip, plan, epoch);
+    }
+
+    /// Compute routes for a bundle of trips with common source and start
+    /// time in a single search over the union of the requested NFAs.
+    /// Cached plans are taken from the cache; only the rest is searched.
+    void find_paths(const vector<Trip_Request> &bundle, vector<Plan> &plans,
+                    double &time_elapsed)
+    {
+        shared_ptr<const Edge_Costs> costs = context.costs();
+        unsigned long epoch = costs ? costs->epoch : 0;
+        plans.resize(bundle.size());
+        vector<Trip_Request> open_trips;
+        vector<unsigned int> open_index;
+        for (unsigned int i = 0; i < bundle.size(); ++i)
+        {
+            plans[i].path.clear();
+            plans[i].budget_exceeded = false;
+            if (plan_cache && plan_cache->lookup(bundle[i], plans[i], epoch))
+                check_budget(plans[i]);
+            else
+            {
+                open_trips.push_back(bundle[i]);
+                open_index.push_back(i);
+            }
+        }
+
+        time_elapsed = 0;
+        if (open_trips.empty())
+            return;
+
+        multi_dijkstra->set_costs(costs.get());
+        multi_dijkstra->set_budget(budget);
+        multi_dijkstra->init(open_trips);
         Timer timer;
-        dijkstra[nfaChoice][algorithm]->dijkstra();
+        multi_dijkstra->dijkstra();
         time_elapsed = timer.elapsed();
-        dijkstra[nfaChoice][algorithm]->reconstruct_path(plan);
+        for (unsigned int j = 0; j < open_trips.size(); ++j)
+        {
+            Plan &plan = plans[open_index[j]];
+            multi_dijkstra->reconstruct_path(plan, j);
+            check_budget(plan);
+            if (plan_cache && !plan.budget_exceeded)
+                plan_cache->insert(open_trips[j], plan, epoch);
+        }
+        multi_dijkstra->set_costs(NULL);
+    }
+};
+
+/// Group trips with common source and start time.
+/// Groups appear in order of their first trip and hold trip indices.
+void group_by_origin(const vector<Trip_Request> &trips,
+                     vector<vector<size_t> > &groups)
+{
+    map<pair<long, float>, size_t> group_index;
+    for (size_t i = 0; i < trips.size(); ++i)
+    {
+        pair<long, float> origin(trips[i].source, trips[i].start_time);
+        map<pair<long, float>, size_t>::iterator it = group_index.find(origin);
+        if (it == group_index.end())
+        {
+            group_index[origin] = groups.size();
+            groups.push_back(vector<size_t>(1, i));
+        }
+        else
+            groups[it->second].push_back(i);
+    }
+}
+
+/// Remove exact duplicates (same source, destination, start time and nfaID).
+/// distinct receives the first trip of each kind, in input order, and
+/// copy_of[i] the index in distinct of trip i.
+void deduplicate(const vector<Trip_Request> &trips,
+                 vector<Trip_Request> &distinct, vector<size_t> &copy_of)
+{
+    map<tuple<long, long, float, float>, size_t> distinct_index;
+    copy_of.resize(trips.size());
+    for (size_t i = 0; i < trips.size(); ++i)
+    {
+        tuple<long, long, float, float> trip(trips[i].source, trips[i].destination,
+                                             trips[i].start_time, trips[i].nfaID);
+        map<tuple<long, long, float, float>, size_t>::iterator it = distinct_index.find(trip);
+        if (it == distinct_index.end())
+        {
+            copy_of[i] = distinct.size();
+            distinct_index[trip] = distinct.size();
+            distinct.push_back(trips[i]);
+        }
+        else
+            copy_of[i] = it->second;
+    }
+}
+
+/// Space-filling-curve key of trips.
+/// Source and destination coordinates are quantised to 16 bits over the
+/// bounding box of the network and their bits interleaved (Z-order), so
+/// trips with nearby sources and destinations get nearby keys.
+class Locality_Key
+{
+protected:
+    /// Network graph.
+    const Network_Graph &network;
+
+    /// Bounding box of the network.
+    float min_x, min_y, scale_x, scale_y;
+
+    /// Quantise coordinate to 16 bits.
+    static unsigned int quantise(float value, float min, float scale)
+    {
+        float q = (value - min) * scale;
+        return q <= 0 ? 0 : q >= 65535 ? 65535 : (unsigned int)q;
+    }
+
+public:
+    /// Constructor.
+    Locality_Key(const Network_Graph &n) : network(n), min_x(0), min_y(0), scale_x(0), scale_y(0)
+    {
+        float max_x = 0, max_y = 0;
+        for (Network_Graph::const_iterator it = network.begin(); it != network.end(); ++it)
+        {
+            if (it == network.begin() || (*it)->x_coord() < min_x)
+                min_x = (*it)->x_coord();
+            if (it == network.begin() || (*it)->y_coord() < min_y)
+                min_y = (*it)->y_coord();
+            if (it == network.begin() || (*it)->x_coord() > max_x)
+                max_x = (*it)->x_coord();
+            if (it == network.begin() || (*it)->y_coord() > max_y)
+                max_y = (*it)->y_coord();
+        }
+        scale_x = max_x > min_x ? 65535 / (max_x - min_x) : 0;
+        scale_y = max_y > min_y ? 65535 / (max_y - min_y) : 0;
+    }
+
+    /// Get key of trip.
+    unsigned long long operator()(const Trip_Request &trip) const
+    {
+        const Network_Vertex *source = network[network.internal_id(trip.source)];
+        const Network_Vertex *destination = network[network.internal_id(trip.destination)];
+        unsigned int coords[4] = {quantise(source->x_coord(), min_x, scale_x),
+                                  quantise(source->y_coord(), min_y, scale_y),
+                                  quantise(destination->x_coord(), min_x, scale_x),
+                                  quantise(destination->y_coord(), min_y, scale_y)};
+        unsigned long long key = 0;
+        for (int bit = 15; bit >= 0; --bit)
+            for (int c = 0; c < 4; ++c)
+                key = (key << 1) | ((coords[c] >> bit) & 1);
+        return key;
+    }
+};
+
+/// Order groups of trips so that consecutive groups touch nearby parts of
+/// the network: by nfaID of their first trip, then by its locality key.
+void sort_by_locality(const vector<Trip_Request> &trips, const Locality_Key &locality,
+                      vector<vector<size_t> > &groups)
+{
+    vector<pair<pair<float, unsigned long long>, size_t> > keys(groups.size());
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        const Trip_Request &trip = trips[groups[g].front()];
+        keys[g] = make_pair(make_pair(trip.nfaID, locality(trip)), g);
+    }
+    sort(keys.begin(), keys.end());
+
+    vector<vector<size_t> > sorted(groups.size());
+    for (size_t g = 0; g < keys.size(); ++g)
+        sorted[g].swap(groups[keys[g].second]);
+    groups.swap(sorted);
+}
+
+/// Selection of the trips routed by one of several processes.
+/// Trips are assigned by a hash of their ID or, by range, in contiguous
+/// blocks of input positions; either way every trip belongs to exactly one
+/// shard, independent of how the processes are scheduled.
+struct Shard
+{
+    /// Shard of this process (0..count-1).
+    unsigned int index;
+
+    /// Number of shards.
+    unsigned int count;
+
+    /// Split input positions into contiguous ranges instead of hashing IDs.
+    bool by_range;
+
+    /// Total number of input trips (range mode only).
+    size_t nmb_trips;
+
+    /// Constructor; a single shard holding all trips.
+    Shard() : index(0), count(1), by_range(false), nmb_trips(0) {}
+
+    /// Does trip at given input position belong to this shard?
+    bool contains(const Trip_Request &trip, size_t position) const
+    {
+        if (count == 1)
+            return true;
+        if (by_range)
+            return (unsigned long long)position * count / max(nmb_trips, (size_t)1) == index;
+        unsigned long long h = (unsigned long long)trip.id + 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h % count == index;
     }
 };
 
@@ -0,0 +1,132 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef TRIP_BATCH_HPP
+#define TRIP_BATCH_HPP
+
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "tools.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Trips with their duplicates and bundles.
+struct Trip_Batch
+{
+  /// All trips in input order.
+  vector<Trip_Request> trips;
+
+  /// Distinct trips.
+  vector<Trip_Request> distinct;
+
+  /// Index of each trip in distinct.
+  vector<size_t> copy_of;
+
+  /// Trips sharing each distinct trip.
+  vector<vector<size_t> > copies;
+
+  /// Distinct trips sharing source and start time.
+  vector<vector<size_t> > bundles;
+};
+
+
+/// Drop exact duplicates and bundle trips by origin.
+void prepare_trips(Trip_Batch &batch)
+{
+  // exact duplicates are routed once and their plan is written for each
+  deduplicate(batch.trips, batch.distinct, batch.copy_of);
+  batch.copies.resize(batch.distinct.size());
+  for (size_t i = 0; i < batch.trips.size(); ++i)
+    batch.copies[batch.copy_of[i]].push_back(i);
+
+  // trips sharing source and start time are routed in one joint search
+  group_by_origin(batch.distinct, batch.bundles);
+}
+
+
+/// Route one bundle of batch.
+void route_bundle(Router &router, unsigned int algorithm, const Trip_Batch &batch, size_t b, vector<Trip_Request> &bundle_trips, vector<Plan> &bundle_plans)
+{
+  const vector<size_t> &bundle = batch.bundles[b];
+  double time_elapsed;
+
+  bundle_trips.clear();
+  for (size_t i = 0; i < bundle.size(); ++i)
+    bundle_trips.push_back(batch.distinct[bundle[i]]);
+
+  if (bundle_trips.size() == 1 || algorithm != STD)
+  {
+    bundle_plans.resize(bundle_trips.size());
+    for (size_t i = 0; i < bundle_trips.size(); ++i)
+    {
+      bundle_plans[i].path.clear();
+      router.find_path((Algorithm)algorithm, bundle_trips[i], bundle_plans[i],
+                       time_elapsed, bundle_trips[i].nfaID);
+    }
+  }
+  else
+    router.find_paths(bundle_trips, bundle_plans, time_elapsed);
+}
+
+
+/// Route all trips of batch.
+/// plans receives the plan of each distinct trip; the plan of trip i is
+/// plans[batch.copy_of[i]].  With a locality key, bundles are routed in
+/// locality order.
+void route_batch(Router &router, unsigned int algorithm, Trip_Batch &batch, const Locality_Key *locality, vector<Plan> &plans)
+{
+  vector<Trip_Request> bundle_trips;
+  vector<Plan> bundle_plans;
+  prepare_trips(batch);
+  if (locality)
+    sort_by_locality(batch.distinct, *locality, batch.bundles);
+  plans.assign(batch.distinct.size(), Plan());
+  for (size_t b = 0; b < batch.bundles.size(); ++b)
+  {
+    route_bundle(router, algorithm, batch, b, bundle_trips, bundle_plans);
+    for (size_t i = 0; i < bundle_trips.size(); ++i)
+    {
+      plans[batch.bundles[b][i]].path.swap(bundle_plans[i].path);
+      plans[batch.bundles[b][i]].budget_exceeded = bundle_plans[i].budget_exceeded;
+    }
+  }
+}
+
+
+/// Split bundles into work ranges of at least batch_trips distinct trips.
+void split_bundles(const Trip_Batch &batch, size_t batch_trips, vector<size_t> &boundaries)
+{
+  boundaries.assign(1, 0);
+  size_t nmb_trips = 0;
+  for (size_t b = 0; b < batch.bundles.size(); ++b)
+  {
+    nmb_trips += batch.bundles[b].size();
+    if (nmb_trips >= batch_trips || b + 1 == batch.bundles.size())
+    {
+      boundaries.push_back(b + 1);
+      nmb_trips = 0;
+    }
+  }
+}
+
+
+/// Split input trips into work ranges of batch_trips trips.
+void split_trips(const Trip_Batch &batch, size_t batch_trips, vector<size_t> &boundaries)
+{
+  boundaries.clear();
+  for (size_t i = 0; i < batch.trips.size(); i += batch_trips)
+    boundaries.push_back(i);
+  boundaries.push_back(batch.trips.size());
+}
+
+
+#endif
@@ -0,0 +1,114 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef TRIP_FILE_HPP
+#define TRIP_FILE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Binary trip file format, for trips resolved against one network.
+/// Header: magic "RRTRIPS" + format version byte, network fingerprint
+/// (u64), number of trips n (u64).  Columns of n entries follow, each
+/// naturally aligned:
+///
+///   u64  trip ID
+///   u32  internal source vertex ID
+///   u32  internal destination vertex ID
+///   f32  start time
+///   f32  NFA ID
+///
+/// Numbers are stored little-endian, i.e. as in memory on the hosts we
+/// route on, so a mapped file is used without conversion.  Internal IDs
+/// are only valid for the network they were resolved against; loading
+/// compares its fingerprint with that of the loaded network.
+const char TRIP_MAGIC[8] = { 'R', 'R', 'T', 'R', 'I', 'P', 'S', 1 };
+
+
+/// Header of a binary trip file.
+struct Trip_File_Header
+{
+  char magic[8];
+  uint64_t fingerprint;
+  uint64_t nmb_trips;
+};
+
+
+/// Get size of a binary trip file of n trips.
+size_t trip_file_size(uint64_t n)
+{
+  return sizeof(Trip_File_Header) + n * (8 + 4 + 4 + 4 + 4);
+}
+
+
+/// Fingerprint of the vertex numbering and topology of a network.
+/// Changes of edge costs keep the fingerprint.
+uint64_t network_fingerprint(const Network_Graph& network)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  auto mix = [&h](uint64_t value) {
+    h = (h ^ value) * 0x100000001b3ULL;
+    h ^= h >> 29;
+  };
+  mix(network.size());
+  for (Network_Graph::const_iterator vertex_it = network.begin();
+       vertex_it != network.end(); vertex_it++)
+  {
+    mix((*vertex_it)->external_id());
+    for (Network_Vertex::Edge_It edge_it = (*vertex_it)->out_edge_begin();
+	 edge_it != (*vertex_it)->out_edge_end(); edge_it++)
+    {
+      mix((*edge_it)->head()->id());
+      mix((*edge_it)->label());
+    }
+  }
+  return h;
+}
+
+
+/// Write trips with internal vertex IDs ids of sources and destinations.
+/// Returns false on error.
+bool write_trip_file(const char* filename, uint64_t fingerprint,
+		     const vector<unsigned long>& id,
+		     const vector<long>& source_index,
+		     const vector<long>& destination_index,
+		     const vector<float>& start_time,
+		     const vector<float>& nfa)
+{
+  ofstream out(filename, ios::binary);
+  Trip_File_Header header;
+  memcpy(header.magic, TRIP_MAGIC, 8);
+  header.fingerprint = fingerprint;
+  header.nmb_trips = id.size();
+  out.write((const char*)&header, sizeof(header));
+
+  vector<uint64_t> ids(id.begin(), id.end());
+  vector<uint32_t> sources(source_index.begin(), source_index.end());
+  vector<uint32_t> destinations(destination_index.begin(), destination_index.end());
+  out.write((const char*)ids.data(), ids.size() * 8);
+  out.write((const char*)sources.data(), sources.size() * 4);
+  out.write((const char*)destinations.data(), destinations.size() * 4);
+  out.write((const char*)start_time.data(), start_time.size() * 4);
+  out.write((const char*)nfa.data(), nfa.size() * 4);
+  out.close();
+  return !out.fail();
+}
+
+
+#endif
@@ -0,0 +1,601 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef TRIP_LOADER_HPP
+#define TRIP_LOADER_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dijkstra.hpp"
+#include "graph.hpp"
+#include "trip_file.hpp"
+#include "trip_text.hpp"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Trips in columns (structure of arrays).
+struct Trip_Columns
+{
+  /// Trip IDs.
+  vector<unsigned long> id;
+
+  /// External source and destination vertex IDs.
+  vector<long> source;
+  vector<long> destination;
+
+  /// Internal source and destination vertex IDs.
+  vector<long> source_index;
+  vector<long> destination_index;
+
+  /// Start times.
+  vector<float> start_time;
+
+  /// NFA IDs.
+  vector<float> nfa;
+
+  /// Line (record in binary files) of each trip in its file.
+  vector<size_t> line;
+
+  /// Get number of trips.
+  size_t size() const { return id.size(); }
+
+  /// Remove all trips.
+  void clear();
+
+  /// Get trip i as a request.
+  Trip_Request request(size_t i) const
+  {
+    Trip_Request trip;
+    trip.id = id[i];
+    trip.source = source[i];
+    trip.destination = destination[i];
+    trip.start_time = start_time[i];
+    trip.nfaID = nfa[i];
+    return trip;
+  }
+
+  /// Append trips of other, with line numbers shifted by first_line.
+  void append(const Trip_Columns& other, size_t first_line);
+};
+
+
+void Trip_Columns::clear()
+{
+  id.clear();
+  source.clear();
+  destination.clear();
+  source_index.clear();
+  destination_index.clear();
+  start_time.clear();
+  nfa.clear();
+  line.clear();
+}
+
+
+void Trip_Columns::append(const Trip_Columns& other, size_t first_line)
+{
+  id.insert(id.end(), other.id.begin(), other.id.end());
+  source.insert(source.end(), other.source.begin(), other.source.end());
+  destination.insert(destination.end(), other.destination.begin(), other.destination.end());
+  source_index.insert(source_index.end(), other.source_index.begin(), other.source_index.end());
+  destination_index.insert(destination_index.end(), other.destination_index.begin(),
+			   other.destination_index.end());
+  start_time.insert(start_time.end(), other.start_time.begin(), other.start_time.end());
+  nfa.insert(nfa.end(), other.nfa.begin(), other.nfa.end());
+  for (size_t i = 0; i < other.line.size(); ++i)
+    line.push_back(first_line + other.line[i]);
+}
+
+
+
+/// Malformed line of a trip file.
+struct Trip_Error
+{
+  /// Line number (from 1).
+  size_t line;
+
+  /// What is wrong.
+  string message;
+};
+
+
+
+/// Loader of trip files.
+/// A trip file has one trip per line: trip ID, source and destination
+/// vertex (external IDs), start time and NFA ID, separated by blanks.
+/// The file is mapped into memory, split at line boundaries into one part
+/// per thread, and the parts are parsed in parallel.  Vertex IDs are
+/// resolved against the network in the same pass; lines with missing or
+/// invalid fields, with unknown vertices or NFA IDs, are collected as
+/// errors.
+/// Binary trip files (trip_file.hpp) are recognised by their magic and
+/// taken over without parsing or resolving, if made for this network.
+class Trip_Loader
+{
+  friend class Trip_Reader;
+
+protected:
+  /// Network for resolving vertex IDs.
+  const Network_Graph& network;
+
+  /// Number of parser threads.
+  unsigned int nmb_threads;
+
+  /// Number of NFAs; NFA IDs must be below it (0: not checked).
+  size_t nmb_nfas;
+
+  /// Smallest part of a file parsed by a thread of its own.
+  static const size_t MIN_PART_BYTES = 1 << 20;
+
+  /// Errors of last load.
+  vector<Trip_Error> load_errors;
+
+  /// Error of last load concerning the whole file.
+  string load_error;
+
+  /// Fingerprint of network (0: not computed yet).
+  mutable uint64_t fingerprint;
+
+  /// Take over trips of binary trip file data.
+  bool load_binary(const char* data, size_t size, Trip_Columns& trips);
+
+  /// Check header of binary trip file data; false if the trips cannot be
+  /// used, with error message unless the data is damaged.
+  bool check_binary(const char* data, size_t size, Trip_File_Header& header,
+		    string& error) const;
+
+  /// Check trip of a binary trip file; false with error message if invalid.
+  bool check_binary_trip(uint32_t source, uint32_t destination, float nfa,
+			 string& error) const;
+
+  /// Parse lines [begin, end) into trips, numbering lines from 1.
+  /// Returns number of lines.
+  size_t parse(const char* begin, const char* end, Trip_Columns& trips,
+	       vector<Trip_Error>& errors) const;
+
+  /// Parse line into trips; false with error message if malformed.
+  bool parse_line(const char* begin, const char* end, size_t line,
+		  Trip_Columns& trips, string& error) const;
+
+
+public:
+  /// Constructor; NFA IDs are checked against nfas NFAs unless 0.
+  Trip_Loader(const Network_Graph& n, unsigned int threads = 1, size_t nfas = 0):
+    network(n), nmb_threads(threads > 0 ? threads : 1), nmb_nfas(nfas),
+    load_errors(), load_error(), fingerprint(0) {}
+
+  /// Is NFA ID valid?
+  bool valid_nfa(double nfa) const
+  {
+    return nfa >= 0 && (nmb_nfas == 0 || nfa < nmb_nfas);
+  }
+
+  /// Append trips of file to trips.  Returns false if the file could not
+  /// be used (see error()) or has malformed lines (see errors()).
+  bool load(const char* filename, Trip_Columns& trips);
+
+  /// Get malformed lines of last load, in line order.
+  const vector<Trip_Error>& errors() const { return load_errors; }
+
+  /// Get error of last load concerning the whole file (empty if none).
+  const string& error() const { return load_error; }
+};
+
+
+bool Trip_Loader::load(const char* filename, Trip_Columns& trips)
+{
+  load_errors.clear();
+  load_error.clear();
+  int fd = open(filename, O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0)
+  {
+    load_error = "could not open file " + string(filename) + " (" + strerror(errno) + ").";
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  size_t size = status.st_size;
+  if (size == 0)
+  {
+    close(fd);
+    return true;
+  }
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    load_error = "could not map file " + string(filename) + " (" + strerror(errno) + ").";
+    return false;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  const char* data = (const char*)mapping;
+
+  if (size >= sizeof(TRIP_MAGIC) && memcmp(data, TRIP_MAGIC, sizeof(TRIP_MAGIC)) == 0)
+  {
+    bool ok = load_binary(data, size, trips);
+    munmap(mapping, size);
+    if (!ok && load_errors.empty())
+      load_error = "binary trip file " + string(filename) + " "
+	+ (load_error.empty() ? "is damaged." : load_error);
+    return ok;
+  }
+
+  // parts start after a newline
+  size_t nmb_parts = min((size_t)nmb_threads, size / MIN_PART_BYTES + 1);
+  vector<const char*> bounds(1, data);
+  for (size_t p = 1; p < nmb_parts; ++p)
+  {
+    const char* split = max(bounds.back(), data + size * p / nmb_parts);
+    const char* newline = (const char*)memchr(split, '\n', data + size - split);
+    if (!newline)
+      break;
+    bounds.push_back(newline + 1);
+  }
+  bounds.push_back(data + size);
+  nmb_parts = bounds.size() - 1;
+
+  vector<Trip_Columns> parts(nmb_parts);
+  vector<vector<Trip_Error> > part_errors(nmb_parts);
+  vector<size_t> part_lines(nmb_parts);
+  vector<std::thread> threads;
+  for (size_t p = 1; p < nmb_parts; ++p)
+    threads.push_back(std::thread([&, p]() {
+	  part_lines[p] = parse(bounds[p], bounds[p + 1], parts[p], part_errors[p]);
+	}));
+  part_lines[0] = parse(bounds[0], bounds[1], parts[0], part_errors[0]);
+  for (auto& thread : threads)
+    thread.join();
+  munmap(mapping, size);
+
+  // line numbers of a part start after those of the parts before
+  size_t first_line = 0;
+  for (size_t p = 0; p < nmb_parts; ++p)
+  {
+    trips.append(parts[p], first_line);
+    for (size_t e = 0; e < part_errors[p].size(); ++e)
+    {
+      load_errors.push_back(part_errors[p][e]);
+      load_errors.back().line += first_line;
+    }
+    first_line += part_lines[p];
+  }
+  return load_errors.empty();
+}
+
+
+bool Trip_Loader::check_binary(const char* data, size_t size, Trip_File_Header& header,
+			       string& error) const
+{
+  if (size < sizeof(header))
+    return false;
+  memcpy(&header, data, sizeof(header));
+  if (header.nmb_trips > size || size != trip_file_size(header.nmb_trips))
+    return false;
+  if (fingerprint == 0)
+    fingerprint = network_fingerprint(network);
+  if (header.fingerprint != fingerprint)
+  {
+    error = "was made for another network.";
+    return false;
+  }
+  return true;
+}
+
+
+bool Trip_Loader::check_binary_trip(uint32_t source, uint32_t destination, float nfa,
+				    string& error) const
+{
+  if (!valid_nfa(nfa))
+  {
+    error = "unknown NFA ID " + ftos(nfa);
+    return false;
+  }
+  if (source == 0 || source >= network.size() ||
+      destination == 0 || destination >= network.size())
+  {
+    error = "invalid internal vertex ID";
+    return false;
+  }
+  return true;
+}
+
+
+bool Trip_Loader::load_binary(const char* data, size_t size, Trip_Columns& trips)
+{
+  Trip_File_Header header;
+  if (!check_binary(data, size, header, load_error))
+    return false;
+
+  size_t n = header.nmb_trips;
+  const uint64_t* id = (const uint64_t*)(data + sizeof(header));
+  const uint32_t* source = (const uint32_t*)(id + n);
+  const uint32_t* destination = source + n;
+  const float* start_time = (const float*)(destination + n);
+  const float* nfa = start_time + n;
+
+  size_t first = trips.size();
+  trips.id.insert(trips.id.end(), id, id + n);
+  trips.source_index.insert(trips.source_index.end(), source, source + n);
+  trips.destination_index.insert(trips.destination_index.end(), destination, destination + n);
+  trips.start_time.insert(trips.start_time.end(), start_time, start_time + n);
+  trips.nfa.insert(trips.nfa.end(), nfa, nfa + n);
+  trips.source.resize(first + n);
+  trips.destination.resize(first + n);
+  trips.line.resize(first + n);
+  string error;
+  for (size_t i = 0; i < n; ++i)
+  {
+    trips.line[first + i] = i + 1;
+    if (!check_binary_trip(source[i], destination[i], nfa[i], error))
+    {
+      Trip_Error trip_error = { i + 1, error };
+      load_errors.push_back(trip_error);
+      continue;
+    }
+    trips.source[first + i] = network[source[i]]->external_id();
+    trips.destination[first + i] = network[destination[i]]->external_id();
+  }
+  return load_errors.empty();
+}
+
+
+size_t Trip_Loader::parse(const char* begin, const char* end, Trip_Columns& trips,
+			  vector<Trip_Error>& errors) const
+{
+  size_t line = 0;
+  string error;
+  while (begin < end)
+  {
+    const char* line_end = (const char*)memchr(begin, '\n', end - begin);
+    if (!line_end)
+      line_end = end;
+    ++line;
+    if (!parse_line(begin, line_end, line, trips, error))
+    {
+      Trip_Error trip_error = { line, error };
+      errors.push_back(trip_error);
+    }
+    begin = line_end + 1;
+  }
+  return line;
+}
+
+
+bool Trip_Loader::parse_line(const char* begin, const char* end, size_t line,
+			     Trip_Columns& trips, string& error) const
+{
+  Trip_Fields fields;
+  bool blank;
+  if (!parse_trip_fields(begin, end, fields, blank, error))
+    return false;
+  if (blank)
+    return true;
+  long source_index = network.find_internal_id(fields.source);
+  long destination_index = network.find_internal_id(fields.destination);
+  if (source_index == 0 || destination_index == 0)
+  {
+    error = "unknown " + string(source_index == 0 ? "source" : "destination")
+      + " vertex " + itos(source_index == 0 ? fields.source : fields.destination);
+    return false;
+  }
+  if (!valid_nfa(fields.nfa))
+  {
+    error = "unknown NFA ID " + itos(fields.nfa);
+    return false;
+  }
+
+  trips.id.push_back(fields.id);
+  trips.source.push_back(fields.source);
+  trips.destination.push_back(fields.destination);
+  trips.source_index.push_back(source_index);
+  trips.destination_index.push_back(destination_index);
+  trips.start_time.push_back(fields.start_time);
+  trips.nfa.push_back(fields.nfa);
+  trips.line.push_back(line);
+  return true;
+}
+
+
+/// Sequential reader of a trip file, for streaming trips in constant
+/// memory (new_main -P).  Trips are checked like by the Trip_Loader given;
+/// reading stops at the first malformed line (record in binary files).
+/// Binary trip files are mapped and their columns read in step.
+class Trip_Reader
+{
+protected:
+  /// Loader whose checks are applied.
+  const Trip_Loader& loader;
+
+  /// Name of the file.
+  string filename;
+
+  /// Text file.
+  ifstream file;
+
+  /// Number of the last line read (from 1).
+  size_t line_number;
+
+  /// Last line read.
+  string text;
+
+  /// Trip of the last line.
+  Trip_Columns trip;
+
+  /// Mapping of a binary trip file (NULL for text files).
+  void* mapping;
+
+  /// Size of mapping.
+  size_t mapping_size;
+
+  /// Number of trips of a binary trip file.
+  size_t nmb_trips;
+
+  /// Columns of a binary trip file.
+  const uint64_t* ids;
+  const uint32_t* sources;
+  const uint32_t* destinations;
+  const float* start_times;
+  const float* nfas;
+
+  /// Message of the last error.
+  string error_message;
+
+  /// Map binary trip file.
+  bool open_binary();
+
+  /// Read next trip of a binary trip file.
+  bool next_binary(Trip_Request& request);
+
+
+public:
+  /// Constructor.
+  Trip_Reader(const Trip_Loader& l):
+    loader(l), filename(), file(), line_number(0), text(), trip(),
+    mapping(NULL), mapping_size(0), nmb_trips(0), ids(NULL), sources(NULL),
+    destinations(NULL), start_times(NULL), nfas(NULL), error_message() {}
+
+  /// Destructor.
+  ~Trip_Reader()
+  {
+    if (mapping)
+      munmap(mapping, mapping_size);
+  }
+
+  /// Open file; false with error message on error.
+  bool open(const char* name);
+
+  /// Read next trip; false at the end of the file or, with error message,
+  /// on a malformed line.
+  bool next(Trip_Request& request);
+
+  /// Get message of the last error (empty if none).
+  const string& error() const { return error_message; }
+};
+
+
+bool Trip_Reader::open(const char* name)
+{
+  filename = name;
+  line_number = 0;
+  error_message.clear();
+  char magic[sizeof(TRIP_MAGIC)];
+  ifstream probe(name, ios::binary);
+  if (probe.read(magic, sizeof(magic)) && memcmp(magic, TRIP_MAGIC, sizeof(magic)) == 0)
+    return open_binary();
+  file.open(name);
+  if (!file)
+  {
+    error_message = "could not open file " + filename + " (" + strerror(errno) + ").";
+    return false;
+  }
+  return true;
+}
+
+
+bool Trip_Reader::open_binary()
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0)
+  {
+    error_message = "could not open file " + filename + " (" + strerror(errno) + ").";
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  mapping_size = status.st_size;
+  mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    mapping = NULL;
+    error_message = "could not map file " + filename + " (" + strerror(errno) + ").";
+    return false;
+  }
+  madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+  const char* data = (const char*)mapping;
+  Trip_File_Header header;
+  string message;
+  if (!loader.check_binary(data, mapping_size, header, message))
+  {
+    error_message = "binary trip file " + filename + " "
+      + (message.empty() ? "is damaged." : message);
+    return false;
+  }
+  nmb_trips = header.nmb_trips;
+  ids = (const uint64_t*)(data + sizeof(header));
+  sources = (const uint32_t*)(ids + nmb_trips);
+  destinations = sources + nmb_trips;
+  start_times = (const float*)(destinations + nmb_trips);
+  nfas = start_times + nmb_trips;
+  return true;
+}
+
+
+bool Trip_Reader::next_binary(Trip_Request& request)
+{
+  if (line_number == nmb_trips)
+    return false;
+  size_t i = line_number++;
+  string message;
+  if (!loader.check_binary_trip(sources[i], destinations[i], nfas[i], message))
+  {
+    error_message = filename + ":" + itos(line_number) + ": " + message + ".";
+    return false;
+  }
+  request.id = ids[i];
+  request.source = loader.network[sources[i]]->external_id();
+  request.destination = loader.network[destinations[i]]->external_id();
+  request.start_time = start_times[i];
+  request.nfaID = nfas[i];
+  return true;
+}
+
+
+bool Trip_Reader::next(Trip_Request& request)
+{
+  if (mapping)
+    return next_binary(request);
+  string message;
+  while (getline(file, text))
+  {
+    ++line_number;
+    trip.clear();
+    if (!loader.parse_line(text.data(), text.data() + text.size(), line_number, trip, message))
+    {
+      error_message = filename + ":" + itos(line_number) + ": " + message + ".";
+      return false;
+    }
+    if (trip.size() == 1)
+    {
+      request = trip.request(0);
+      return true;
+    }
+  }
+  if (file.bad())
+    error_message = "could not read file " + filename + " (" + strerror(errno) + ").";
+  return false;
+}
+
+
+#endif
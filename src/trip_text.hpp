@@ -0,0 +1,107 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef TRIP_TEXT_HPP
+#define TRIP_TEXT_HPP
+
+#include <cctype>
+#include <charconv>
+#include <string>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Text trip format, read by the trip loader of new_main and by
+/// route_client.  One line per trip, fields separated by white space:
+///
+///   id  source  destination  start time  NFA ID
+///
+/// Blank lines are skipped.  Each field must be a number as a whole.
+
+/// Fields of a trip line.
+struct Trip_Fields
+{
+  long id;
+  long source;
+  long destination;
+  double start_time;
+  long nfa;
+};
+
+
+/// Parse trip line [begin, end); blank is set for a blank line.
+/// Returns false with error message if malformed.  Vertex and NFA IDs are
+/// not checked against a network.
+bool parse_trip_fields(const char* begin, const char* end, Trip_Fields& trip,
+		       bool& blank, string& error)
+{
+  static const char* const names[5] =
+    { "trip ID", "source", "destination", "start time", "NFA ID" };
+  const char* fields[5][2];
+  int nmb_fields = 0;
+  const char* p = begin;
+  for (;;)
+  {
+    while (p < end && isspace((unsigned char)*p))
+      ++p;
+    if (p == end)
+      break;
+    const char* field = p;
+    while (p < end && !isspace((unsigned char)*p))
+      ++p;
+    if (nmb_fields == 5)
+    {
+      error = "more than 5 fields";
+      return false;
+    }
+    fields[nmb_fields][0] = field;
+    fields[nmb_fields][1] = p;
+    ++nmb_fields;
+  }
+  blank = (nmb_fields == 0);
+  if (blank)
+    return true;
+  if (nmb_fields < 5)
+  {
+    error = "expected 5 fields, found " + to_string(nmb_fields);
+    return false;
+  }
+
+  // like operator>>, an explicit plus sign is accepted
+  long value[5];
+  for (int f = 0; f < 5; ++f)
+  {
+    const char* first = fields[f][0];
+    if (*first == '+' && fields[f][1] - first > 1 && first[1] != '-')
+      ++first;
+    from_chars_result result = f == 3 ?
+      from_chars(first, fields[f][1], trip.start_time) :
+      from_chars(first, fields[f][1], value[f]);
+    if (result.ec != errc() || result.ptr != fields[f][1])
+    {
+      error = "invalid " + string(names[f]) + " '"
+	+ string(fields[f][0], fields[f][1]) + "'";
+      return false;
+    }
+  }
+  if (value[0] < 0)
+  {
+    error = "invalid trip ID " + to_string(value[0]);
+    return false;
+  }
+  trip.id = value[0];
+  trip.source = value[1];
+  trip.destination = value[2];
+  trip.nfa = value[4];
+  return true;
+}
+
+
+#endif
@@ -0,0 +1,68 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+  Convert a trip file into the binary trip file format, resolving its
+  vertices against a network once for all later routing runs.
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "dijkstra.hpp"
+#include "graph.hpp"
+#include "trip_file.hpp"
+#include "trip_loader.hpp"
+
+using namespace std;
+
+Event_Handler event_handler;
+
+
+int main(int argc, char* argv[])
+{
+  if (argc < 5)
+  {
+    cout << "Usage: trips_to_binary <graph> <coords> <trips> <binary trips>" << endl
+	 << " Resolves the trips of a trip file against the network given by"
+	 << " graph (edge) and coords (vertex) file and writes them in the"
+	 << " binary trip format read by new_main -f." << endl;
+    return 0;
+  }
+
+  Network_Graph network(argv[1], argv[2]);
+  if (network.size() > UINT32_MAX)
+  {
+    cout << "Sorry, the network has too many vertices for the binary trip format. Bye!" << endl;
+    exit(-1);
+  }
+
+  Trip_Loader loader(network, std::thread::hardware_concurrency());
+  Trip_Columns trips;
+  if (!loader.load(argv[3], trips))
+  {
+    const vector<Trip_Error>& errors = loader.errors();
+    if (errors.empty())
+      cout << "Sorry, " << loader.error() << " Bye!" << endl;
+    for (size_t e = 0; e < errors.size(); ++e)
+      cout << argv[3] << ":" << errors[e].line << ": " << errors[e].message << endl;
+    if (!errors.empty())
+      cout << "Sorry, the trip file " << argv[3] << " has malformed lines. Bye!" << endl;
+    exit(-1);
+  }
+
+  if (!write_trip_file(argv[4], network_fingerprint(network), trips.id,
+		       trips.source_index, trips.destination_index,
+		       trips.start_time, trips.nfa))
+  {
+    cout << "Sorry, could not write file " << argv[4] << ". Bye!" << endl;
+    exit(-1);
+  }
+  cout << "Wrote " << trips.size() << " trips." << endl;
+  return 0;
+}
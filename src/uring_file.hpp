@@ -0,0 +1,469 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef URING_FILE_HPP
+#define URING_FILE_HPP
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <streambuf>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Minimal io_uring instance (raw system calls, no liburing).
+/// Single-threaded use: one thread submits and reaps.
+class Uring
+{
+protected:
+  /// Ring file descriptor (-1: none).
+  int ring_fd;
+
+  /// Mapped rings and their sizes.
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  io_uring_sqe* sqes;
+  size_t sqes_size;
+
+  /// Submission queue fields.
+  atomic<unsigned>* sq_head;
+  atomic<unsigned>* sq_tail;
+  unsigned sq_mask;
+  unsigned* sq_array;
+
+  /// Completion queue fields.
+  atomic<unsigned>* cq_head;
+  atomic<unsigned>* cq_tail;
+  unsigned cq_mask;
+  io_uring_cqe* cqes;
+
+  /// Submission queue entries.
+  unsigned nmb_entries;
+
+  /// Entries prepared but not yet submitted.
+  unsigned nmb_prepared;
+
+
+public:
+  /// Constructor.
+  Uring():
+    ring_fd(-1), sq_ring(MAP_FAILED), sq_ring_size(0), cq_ring(MAP_FAILED),
+    cq_ring_size(0), sqes((io_uring_sqe*)MAP_FAILED), sqes_size(0),
+    sq_head(NULL), sq_tail(NULL), sq_mask(0), sq_array(NULL),
+    cq_head(NULL), cq_tail(NULL), cq_mask(0), cqes(NULL),
+    nmb_entries(0), nmb_prepared(0) {}
+
+  /// Destructor.
+  ~Uring();
+
+  /// Set up ring of given size; false if io_uring is unavailable.
+  bool setup(unsigned entries);
+
+  /// Register fixed buffers.
+  bool register_buffers(const vector<iovec>& buffers)
+  {
+    return syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS,
+		   buffers.data(), buffers.size()) == 0;
+  }
+
+  /// Get entry to prepare; NULL if the submission queue is full.
+  io_uring_sqe* next_sqe();
+
+  /// Submit prepared entries and wait for at least wait completions.
+  bool submit(unsigned wait);
+
+  /// Take next completion; false if there is none.
+  bool next_cqe(uint64_t& user_data, int& result);
+};
+
+
+Uring::~Uring()
+{
+  if (sqes != MAP_FAILED)
+    munmap(sqes, sqes_size);
+  if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+    munmap(cq_ring, cq_ring_size);
+  if (sq_ring != MAP_FAILED)
+    munmap(sq_ring, sq_ring_size);
+  if (ring_fd >= 0)
+    close(ring_fd);
+}
+
+
+bool Uring::setup(unsigned entries)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd < 0)
+    return false;
+
+  sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    sq_ring_size = cq_ring_size = max(sq_ring_size, cq_ring_size);
+  sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		 ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED)
+    return false;
+  cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring :
+    mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	 ring_fd, IORING_OFF_CQ_RING);
+  if (cq_ring == MAP_FAILED)
+    return false;
+  sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = (io_uring_sqe*)mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+    return false;
+
+  char* sq = (char*)sq_ring;
+  sq_head = (atomic<unsigned>*)(sq + params.sq_off.head);
+  sq_tail = (atomic<unsigned>*)(sq + params.sq_off.tail);
+  sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  sq_array = (unsigned*)(sq + params.sq_off.array);
+  char* cq = (char*)cq_ring;
+  cq_head = (atomic<unsigned>*)(cq + params.cq_off.head);
+  cq_tail = (atomic<unsigned>*)(cq + params.cq_off.tail);
+  cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+  nmb_entries = params.sq_entries;
+  return true;
+}
+
+
+io_uring_sqe* Uring::next_sqe()
+{
+  unsigned tail = sq_tail->load(memory_order_relaxed) + nmb_prepared;
+  if (tail - sq_head->load(memory_order_acquire) >= nmb_entries)
+    return NULL;
+  io_uring_sqe* sqe = &sqes[tail & sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array[tail & sq_mask] = tail & sq_mask;
+  ++nmb_prepared;
+  return sqe;
+}
+
+
+bool Uring::submit(unsigned wait)
+{
+  unsigned submitted = nmb_prepared;
+  sq_tail->store(sq_tail->load(memory_order_relaxed) + nmb_prepared, memory_order_release);
+  nmb_prepared = 0;
+  for (;;)
+  {
+    int result = syscall(__NR_io_uring_enter, ring_fd, submitted, wait,
+			 wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (result >= 0)
+      return true;
+    if (errno != EINTR)
+      return false;
+    submitted = 0;
+  }
+}
+
+
+bool Uring::next_cqe(uint64_t& user_data, int& result)
+{
+  unsigned head = cq_head->load(memory_order_relaxed);
+  if (head == cq_tail->load(memory_order_acquire))
+    return false;
+  const io_uring_cqe& cqe = cqes[head & cq_mask];
+  user_data = cqe.user_data;
+  result = cqe.res;
+  cq_head->store(head + 1, memory_order_release);
+  return true;
+}
+
+
+
+/// Stream buffer writing a file through io_uring.
+/// Data is gathered in a few large fixed (registered) buffers; a full
+/// buffer is submitted as one write at its file offset and the next free
+/// buffer is filled meanwhile, so several writes are in flight and the
+/// writing thread only waits when all buffers are busy.  Without
+/// io_uring the same buffers are written with pwrite.
+class Uring_Buffer : public streambuf
+{
+protected:
+  /// Pending write of a buffer.
+  struct Write
+  {
+    /// Data not written yet.
+    size_t begin;
+    size_t end;
+
+    /// File offset of data.
+    off_t offset;
+  };
+
+  /// File.
+  int fd;
+
+  /// Ring (unused without io_uring).
+  Uring ring;
+
+  /// Is io_uring used?
+  bool use_ring;
+
+  /// Buffers.
+  vector<iovec> buffers;
+
+  /// Pending write of each buffer (begin == end: buffer free).
+  vector<Write> writes;
+
+  /// Buffer being filled.
+  size_t current;
+
+  /// File offset of current buffer.
+  off_t offset;
+
+  /// Writes in flight.
+  unsigned in_flight;
+
+  /// Has a write failed?
+  bool failed;
+
+  /// Submit write of (the rest of) buffer b.
+  void submit(size_t b);
+
+  /// Reap completions, waiting for at least one if wait.
+  void reap(bool wait);
+
+  /// Submit current buffer and continue with a free one.
+  void next_buffer();
+
+  /// Wait for all writes in flight.
+  void drain();
+
+  /// Write buffered data.
+  int sync()
+  {
+    if (failed || fd < 0)
+      return failed ? -1 : 0;
+    next_buffer();
+    drain();
+    return failed ? -1 : 0;
+  }
+
+  int overflow(int c)
+  {
+    if (failed)
+      return traits_type::eof();
+    next_buffer();
+    if (failed)
+      return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+
+public:
+  /// Constructor; nmb_buffers buffers of buffer_bytes each.
+  Uring_Buffer(size_t nmb_buffers = 8, size_t buffer_bytes = 1 << 20);
+
+  /// Destructor.
+  ~Uring_Buffer();
+
+  /// Open file, appending to it or truncating it.
+  bool open(const char* filename, bool append = false);
+
+  /// Is io_uring used?
+  bool uring() const { return use_ring; }
+
+  /// Write remaining data and close file; false if a write failed.
+  bool finish();
+};
+
+
+Uring_Buffer::Uring_Buffer(size_t nmb_buffers, size_t buffer_bytes):
+  fd(-1), ring(), use_ring(false), buffers(nmb_buffers), writes(nmb_buffers),
+  current(0), offset(0), in_flight(0), failed(false)
+{
+  for (size_t b = 0; b < buffers.size(); ++b)
+  {
+    buffers[b].iov_base = aligned_alloc(4096, buffer_bytes);
+    buffers[b].iov_len = buffer_bytes;
+    writes[b].begin = writes[b].end = 0;
+  }
+  char* data = (char*)buffers[0].iov_base;
+  setp(data, data + buffer_bytes);
+}
+
+
+Uring_Buffer::~Uring_Buffer()
+{
+  finish();
+  for (size_t b = 0; b < buffers.size(); ++b)
+    free(buffers[b].iov_base);
+}
+
+
+bool Uring_Buffer::open(const char* filename, bool append)
+{
+  fd = ::open(filename, O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC) | O_CLOEXEC, 0666);
+  if (fd < 0)
+    return false;
+  offset = append ? lseek(fd, 0, SEEK_END) : 0;
+  use_ring = ring.setup(buffers.size()) && ring.register_buffers(buffers);
+  return true;
+}
+
+
+void Uring_Buffer::submit(size_t b)
+{
+  Write& write = writes[b];
+  char* data = (char*)buffers[b].iov_base;
+  if (!use_ring)
+  {
+    while (write.begin < write.end)
+    {
+      ssize_t n = pwrite(fd, data + write.begin, write.end - write.begin, write.offset);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+      {
+	failed = true;
+	break;
+      }
+      write.begin += n;
+      write.offset += n;
+    }
+    write.begin = write.end = 0;
+    return;
+  }
+
+  // one entry per buffer is enough
+  io_uring_sqe* sqe = ring.next_sqe();
+  sqe->opcode = IORING_OP_WRITE_FIXED;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(data + write.begin);
+  sqe->len = write.end - write.begin;
+  sqe->off = write.offset;
+  sqe->buf_index = b;
+  sqe->user_data = b;
+  ++in_flight;
+  if (!ring.submit(0))
+    failed = true;
+}
+
+
+void Uring_Buffer::reap(bool wait)
+{
+  if (wait && !ring.submit(1))
+  {
+    failed = true;
+    return;
+  }
+  uint64_t b;
+  int result;
+  while (ring.next_cqe(b, result))
+  {
+    --in_flight;
+    Write& write = writes[b];
+    if (result <= 0 && result != -EINTR && result != -EAGAIN)
+    {
+      failed = true;
+      write.begin = write.end = 0;
+      continue;
+    }
+    if (result > 0)
+    {
+      write.begin += result;
+      write.offset += result;
+    }
+    // short write: submit the rest
+    if (write.begin < write.end)
+      submit(b);
+    else
+      write.begin = write.end = 0;
+  }
+}
+
+
+void Uring_Buffer::next_buffer()
+{
+  size_t size = pptr() - pbase();
+  if (size > 0)
+  {
+    writes[current].begin = 0;
+    writes[current].end = size;
+    writes[current].offset = offset;
+    offset += size;
+    submit(current);
+  }
+
+  // take a free buffer, waiting for a write to complete if there is none
+  for (;;)
+  {
+    if (use_ring)
+      reap(false);
+    for (size_t i = 1; i <= buffers.size(); ++i)
+    {
+      size_t b = (current + i) % buffers.size();
+      if (writes[b].begin == writes[b].end)
+      {
+	current = b;
+	char* data = (char*)buffers[b].iov_base;
+	setp(data, data + buffers[b].iov_len);
+	return;
+      }
+    }
+    if (failed)
+      return;
+    reap(true);
+  }
+}
+
+
+void Uring_Buffer::drain()
+{
+  // the kernel may still use the buffers until all writes have completed
+  while (use_ring && in_flight > 0)
+  {
+    unsigned before = in_flight;
+    reap(true);
+    if (failed && in_flight == before)
+      break;
+  }
+}
+
+
+bool Uring_Buffer::finish()
+{
+  if (fd < 0)
+    return !failed;
+  if (!failed)
+    next_buffer();
+  drain();
+  if (close(fd) != 0)
+    failed = true;
+  fd = -1;
+  return !failed;
+}
+
+
+#endif
@@ -0,0 +1,131 @@
+/* %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+  Framework: Reg-Exp Router
+
+  Date: 19 Oct 2026
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% */
+
+#ifndef WORK_POOL_HPP
+#define WORK_POOL_HPP
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+
+/// Half-open range of work items.
+struct Work_Range
+{
+  /// Position of range among all ranges.
+  size_t index;
+
+  /// First item.
+  size_t begin;
+
+  /// Item past the last one.
+  size_t end;
+};
+
+
+
+/// Work-stealing pool of work ranges.
+/// Every worker owns a deque of ranges and takes them from the front, in
+/// item order.  A worker whose deque is empty steals from the back of the
+/// other deques, so all workers stay busy until the last range is taken.
+/// Ranges are distributed before the workers start; none are added later.
+class Work_Pool
+{
+protected:
+  /// Deque of one worker.
+  struct Work_Deque
+  {
+    mutex lock;
+    deque<Work_Range> ranges;
+  };
+
+  /// Deques, one per worker.
+  vector<Work_Deque> deques;
+
+  /// Number of stolen ranges.
+  atomic<unsigned long> nmb_steals;
+
+
+public:
+  /// Constructor.
+  Work_Pool(unsigned int nmb_workers): deques(nmb_workers), nmb_steals(0) {}
+
+  /// Get number of workers.
+  unsigned int size() const { return deques.size(); }
+
+  /// Split items into ranges at the given boundaries
+  /// (boundaries[0] == 0, boundaries.back() == number of items)
+  /// and deal consecutive ranges to the workers in equal blocks, or
+  /// round-robin if interleaved, so that the lowest ranges are taken first.
+  /// Ranges marked in skip (if given) are left out; they keep their index.
+  void distribute(const vector<size_t>& boundaries, bool interleaved = false,
+		  const vector<bool>& skip = vector<bool>());
+
+  /// Get next range for worker; false once all deques are empty.
+  bool next(unsigned int worker, Work_Range& range);
+
+  /// Get number of stolen ranges.
+  unsigned long steals() const { return nmb_steals; }
+};
+
+
+void Work_Pool::distribute(const vector<size_t>& boundaries, bool interleaved,
+			   const vector<bool>& skip)
+{
+  vector<size_t> kept;
+  for (size_t r = 0; r + 1 < boundaries.size(); ++r)
+    if (r >= skip.size() || !skip[r])
+      kept.push_back(r);
+  const size_t nmb_ranges = kept.size();
+  for (size_t k = 0; k < nmb_ranges; ++k)
+  {
+    size_t r = kept[k];
+    Work_Range range = { r, boundaries[r], boundaries[r + 1] };
+    Work_Deque& owner = interleaved ? deques[k % deques.size()]
+      : deques[k * deques.size() / nmb_ranges];
+    lock_guard<mutex> guard(owner.lock);
+    owner.ranges.push_back(range);
+  }
+}
+
+
+bool Work_Pool::next(unsigned int worker, Work_Range& range)
+{
+  {
+    Work_Deque& own = deques[worker];
+    lock_guard<mutex> guard(own.lock);
+    if (!own.ranges.empty())
+    {
+      range = own.ranges.front();
+      own.ranges.pop_front();
+      return true;
+    }
+  }
+
+  for (unsigned int i = 1; i < deques.size(); ++i)
+  {
+    Work_Deque& victim = deques[(worker + i) % deques.size()];
+    lock_guard<mutex> guard(victim.lock);
+    if (!victim.ranges.empty())
+    {
+      range = victim.ranges.back();
+      victim.ranges.pop_back();
+      ++nmb_steals;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+#endif